@@ -230,7 +230,25 @@ app.get('/api/status', requireAuth, (req, res) => {
         wifi_rssi: -42,
         uptime_seconds: Math.floor((Date.now() - START_TIME) / 1000),
         free_heap: 200000,
-        modbus_connected: false
+        modbus_connected: false,
+        boot: {
+            modbus_ready_ms: 0,
+            first_poll_ms: 0,
+            first_sample_ms: null,
+            wifi_connected_ms: 0,
+            http_ready_ms: 0
+        },
+        inverter_profile: {
+            name: 'generic',
+            source: 'default',
+            signature: '00000000',
+            disabled_fields: []
+        },
+        modbus_poll: {
+            last_ms: 0,
+            max_ms: 0,
+            interval_ms: 5000
+        }
     });
 });
 
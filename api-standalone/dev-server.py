@@ -179,7 +179,25 @@ def api_status():
         "wifi_rssi": -42,
         "uptime_seconds": int(time.time() - app.config['START_TIME']),
         "free_heap": 200000,
-        "modbus_connected": False
+        "modbus_connected": False,
+        "boot": {
+            "modbus_ready_ms": 0,
+            "first_poll_ms": 0,
+            "first_sample_ms": None,
+            "wifi_connected_ms": 0,
+            "http_ready_ms": 0
+        },
+        "inverter_profile": {
+            "name": "generic",
+            "source": "default",
+            "signature": "00000000",
+            "disabled_fields": []
+        },
+        "modbus_poll": {
+            "last_ms": 0,
+            "max_ms": 0,
+            "interval_ms": 5000
+        }
     })
 
 @app.route('/api/reset', methods=['POST'])
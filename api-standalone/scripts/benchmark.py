@@ -0,0 +1,276 @@
+#!/usr/bin/env python3
+"""
+Benchmark HTTP - Carga e latência da API
+Mede throughput, latência p50/p99 e taxa de erro por rota e por nível de
+concorrência, contra o ESP32 ou contra o dev-server local. Usa apenas a
+biblioteca padrão do Python.
+
+Exemplos:
+    python scripts/benchmark.py --url http://192.168.4.1 --target device
+    python scripts/benchmark.py --url http://localhost:5000 --target host
+    python scripts/benchmark.py --url http://192.168.4.1 --baseline bench-1.0.0.json
+"""
+
+import argparse
+import base64
+import json
+import platform
+import sys
+import threading
+import time
+import urllib.error
+import urllib.request
+
+# Cenários: (nome, caminho, autenticado, status esperado)
+SCENARIOS = [
+    ("sensors_auth", "/api/sensors", True, 200),
+    ("sensors_no_auth", "/api/sensors", False, 401),
+    ("status", "/api/status", True, 200),
+    ("static_css", "/css/style.css", False, 200),
+    ("static_js", "/js/app.js", False, 200),
+]
+
+STATUS_SAMPLE_INTERVAL_S = 2.0
+
+
+def percentile(values, pct):
+    """Percentil por interpolação linear (values já ordenado)"""
+    if not values:
+        return None
+    k = (len(values) - 1) * pct / 100.0
+    lower = int(k)
+    upper = min(lower + 1, len(values) - 1)
+    return values[lower] + (values[upper] - values[lower]) * (k - lower)
+
+
+class Client:
+    """Cliente HTTP mínimo (uma conexão por requisição, como o navegador faz com o ESP32)"""
+
+    def __init__(self, base_url, user, password, timeout):
+        self.base_url = base_url.rstrip('/')
+        self.timeout = timeout
+        token = base64.b64encode(f"{user}:{password}".encode()).decode()
+        self.auth_header = f"Basic {token}"
+
+    def get(self, path, auth):
+        """Retorna (status, latência em ms, corpo). status=None em erro de rede"""
+        request = urllib.request.Request(self.base_url + path)
+        if auth:
+            request.add_header("Authorization", self.auth_header)
+        start = time.perf_counter()
+        try:
+            with urllib.request.urlopen(request, timeout=self.timeout) as response:
+                body = response.read()
+                status = response.status
+        except urllib.error.HTTPError as e:
+            body = e.read()
+            status = e.code
+        except (urllib.error.URLError, OSError):
+            body = b""
+            status = None
+        return status, (time.perf_counter() - start) * 1000.0, body
+
+
+def sample_modbus(client, stop, samples):
+    """Coleta modbus_poll de /api/status enquanto a carga roda"""
+    while not stop.is_set():
+        status, _, body = client.get("/api/status", True)
+        if status == 200:
+            try:
+                poll = json.loads(body).get("modbus_poll")
+                if poll:
+                    samples.append(poll)
+            except ValueError:
+                pass
+        stop.wait(STATUS_SAMPLE_INTERVAL_S)
+
+
+def summarize_modbus(samples):
+    if not samples:
+        return None
+    durations = [s.get("last_ms", 0) for s in samples]
+    intervals = [s.get("interval_ms", 0) for s in samples]
+    return {
+        "samples": len(samples),
+        "poll_ms_mean": sum(durations) / len(durations),
+        "poll_ms_max": max(durations),
+        "interval_ms_mean": sum(intervals) / len(intervals),
+        "interval_ms_max": max(intervals),
+    }
+
+
+def run_level(client, scenario, concurrency, duration):
+    """Executa um cenário com N clientes simultâneos por `duration` segundos"""
+    name, path, auth, expected = scenario
+    latencies = []
+    errors = [0]
+    lock = threading.Lock()
+    deadline = time.perf_counter() + duration
+
+    def worker():
+        local_latencies = []
+        local_errors = 0
+        while time.perf_counter() < deadline:
+            status, latency, _ = client.get(path, auth)
+            local_latencies.append(latency)
+            if status != expected:
+                local_errors += 1
+        with lock:
+            latencies.extend(local_latencies)
+            errors[0] += local_errors
+
+    stop = threading.Event()
+    modbus_samples = []
+    sampler = threading.Thread(target=sample_modbus, args=(client, stop, modbus_samples))
+    sampler.start()
+
+    started = time.perf_counter()
+    threads = [threading.Thread(target=worker) for _ in range(concurrency)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    elapsed = time.perf_counter() - started
+
+    stop.set()
+    sampler.join()
+
+    latencies.sort()
+    total = len(latencies)
+    return {
+        "scenario": name,
+        "path": path,
+        "authenticated": auth,
+        "concurrency": concurrency,
+        "requests": total,
+        "errors": errors[0],
+        "error_rate": errors[0] / total if total else 1.0,
+        "throughput_rps": total / elapsed if elapsed > 0 else 0.0,
+        "latency_ms": {
+            "p50": percentile(latencies, 50),
+            "p99": percentile(latencies, 99),
+            "max": latencies[-1] if latencies else None,
+            "mean": sum(latencies) / total if total else None,
+        },
+        "modbus": summarize_modbus(modbus_samples),
+    }
+
+
+def compare(results, baseline_path, tolerance):
+    """Compara com um resultado anterior; retorna o número de regressões"""
+    with open(baseline_path) as f:
+        baseline = json.load(f)
+    previous = {(r["scenario"], r["concurrency"]): r for r in baseline.get("results", [])}
+    regressions = 0
+
+    print(f"\n📊 Comparação com {baseline_path} (tolerância {tolerance:.0%})")
+    for r in results:
+        old = previous.get((r["scenario"], r["concurrency"]))
+        if not old:
+            continue
+        checks = [
+            ("p99", old["latency_ms"]["p99"], r["latency_ms"]["p99"], True),
+            ("rps", old["throughput_rps"], r["throughput_rps"], False),
+        ]
+        for label, before, after, lower_is_better in checks:
+            if not before or after is None:
+                continue
+            change = (after - before) / before
+            worse = change > tolerance if lower_is_better else change < -tolerance
+            if worse:
+                regressions += 1
+            marker = "❌" if worse else "  "
+            print(f" {marker} {r['scenario']:<16} c={r['concurrency']:<3} {label}: "
+                  f"{before:.1f} → {after:.1f} ({change:+.0%})")
+        if r["error_rate"] > old["error_rate"] + 0.01:
+            regressions += 1
+            print(f" ❌ {r['scenario']:<16} c={r['concurrency']:<3} erros: "
+                  f"{old['error_rate']:.1%} → {r['error_rate']:.1%}")
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark de carga da API MUST Inverter")
+    parser.add_argument("--url", required=True, help="URL base (ex: http://192.168.4.1)")
+    parser.add_argument("--target", default="device", choices=["device", "host"],
+                        help="device = ESP32, host = dev-server local")
+    parser.add_argument("--user", default="admin")
+    parser.add_argument("--password", default="admin123")
+    parser.add_argument("--levels", default="1,2,4,8",
+                        help="Níveis de concorrência separados por vírgula")
+    parser.add_argument("--duration", type=float, default=10.0,
+                        help="Segundos por cenário e nível")
+    parser.add_argument("--timeout", type=float, default=10.0)
+    parser.add_argument("--scenarios", default=None,
+                        help="Filtrar cenários (ex: sensors_auth,static_css)")
+    parser.add_argument("--output", default=None,
+                        help="Arquivo JSON de saída (padrão: bench-<target>-<data>.json)")
+    parser.add_argument("--baseline", default=None,
+                        help="Resultado anterior para comparar (sai com código 1 se regredir)")
+    parser.add_argument("--tolerance", type=float, default=0.2,
+                        help="Variação aceita antes de marcar regressão (0.2 = 20%%)")
+    args = parser.parse_args()
+
+    levels = [int(x) for x in args.levels.split(",") if x.strip()]
+    scenarios = SCENARIOS
+    if args.scenarios:
+        wanted = set(args.scenarios.split(","))
+        scenarios = [s for s in SCENARIOS if s[0] in wanted]
+
+    client = Client(args.url, args.user, args.password, args.timeout)
+
+    # Estado do dispositivo antes da carga (também serve de teste de conexão)
+    status, _, body = client.get("/api/status", True)
+    if status != 200:
+        print(f"❌ /api/status não respondeu (status={status}) em {args.url}")
+        sys.exit(2)
+    device_status = json.loads(body)
+    idle = summarize_modbus([device_status["modbus_poll"]]) if "modbus_poll" in device_status else None
+
+    print("\n" + "=" * 60)
+    print(f"  Benchmark HTTP - {args.url} ({args.target})")
+    print("=" * 60)
+
+    results = []
+    for scenario in scenarios:
+        for concurrency in levels:
+            r = run_level(client, scenario, concurrency, args.duration)
+            results.append(r)
+            lat = r["latency_ms"]
+            p50 = f"{lat['p50']:.1f}" if lat["p50"] is not None else "-"
+            p99 = f"{lat['p99']:.1f}" if lat["p99"] is not None else "-"
+            poll = r["modbus"]["poll_ms_max"] if r["modbus"] else "-"
+            print(f"  {r['scenario']:<16} c={concurrency:<3} {r['throughput_rps']:7.1f} req/s  "
+                  f"p50={p50:>7} ms  p99={p99:>7} ms  erros={r['error_rate']:.1%}  "
+                  f"modbus_max={poll}")
+
+    report = {
+        "meta": {
+            "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
+            "url": args.url,
+            "target": args.target,
+            "device_name": device_status.get("device_name"),
+            "firmware_version": device_status.get("firmware_version"),
+            "levels": levels,
+            "duration_s": args.duration,
+            "client": platform.platform(),
+        },
+        "modbus_idle": idle,
+        "results": results,
+    }
+
+    output = args.output or f"bench-{args.target}-{time.strftime('%Y%m%d-%H%M%S')}.json"
+    with open(output, "w") as f:
+        json.dump(report, f, indent=2)
+    print(f"\n✓ Resultados salvos em {output}")
+
+    if args.baseline:
+        regressions = compare(results, args.baseline, args.tolerance)
+        if regressions:
+            print(f"\n❌ {regressions} regressão(ões) detectada(s)")
+            sys.exit(1)
+        print("\n✓ Nenhuma regressão")
+
+
+if __name__ == "__main__":
+    main()
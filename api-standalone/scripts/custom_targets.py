@@ -4,7 +4,14 @@ Adiciona comandos customizados para upload automatizado
 """
 
 Import("env")
+import base64
+import hashlib
+import json
+import os
 import sys
+import time
+import urllib.error
+import urllib.request
 
 def upload_all_callback(*args, **kwargs):
     """Upload completo: filesystem primeiro, depois firmware"""
@@ -40,6 +47,60 @@ def upload_all_callback(*args, **kwargs):
     print("  3. Acesse: http://192.168.4.1")
     print("")
 
+def upload_ota(image, target):
+    """Envia a imagem para POST /api/update do dispositivo já instalado"""
+    host = env.GetProjectOption("custom_ota_host", "") or os.environ.get("OTA_HOST", "")
+    if not host:
+        print("\n❌ ERRO: defina custom_ota_host no platformio.ini ou a variável OTA_HOST")
+        sys.exit(1)
+    if not os.path.isfile(image):
+        print("\n❌ ERRO: imagem não encontrada: %s" % image)
+        sys.exit(1)
+
+    user = os.environ.get("OTA_USER", "admin")
+    password = os.environ.get("OTA_PASS", "admin123")
+    with open(image, "rb") as f:
+        data = f.read()
+    md5 = hashlib.md5(data).hexdigest()
+
+    url = "http://%s/api/update?target=%s&md5=%s" % (host, target, md5)
+    auth = base64.b64encode(("%s:%s" % (user, password)).encode()).decode()
+    request = urllib.request.Request(url, data=data, method="POST", headers={
+        "Content-Type": "application/octet-stream",
+        "Authorization": "Basic " + auth,
+    })
+
+    print("📡 Enviando %s (%d bytes, MD5 %s) para %s..." % (target, len(data), md5, host))
+    start = time.time()
+    try:
+        with urllib.request.urlopen(request, timeout=120) as response:
+            result = json.loads(response.read().decode())
+    except urllib.error.HTTPError as e:
+        print("\n❌ ERRO: HTTP %d - %s" % (e.code, e.read().decode(errors="replace")))
+        sys.exit(1)
+    except (urllib.error.URLError, OSError) as e:
+        print("\n❌ ERRO: falha na conexão com %s: %s" % (host, e))
+        sys.exit(1)
+
+    update = result.get("update", {})
+    polling = update.get("polling", {})
+    print("✅ Imagem verificada em %.1f s (%d bytes/s no dispositivo)" %
+          (time.time() - start, update.get("throughput_bytes_s", 0)))
+    print("   Leituras Modbus durante o envio: %d, atraso total %d ms (máx. %d ms)" %
+          (polling.get("polls", 0), polling.get("paused_ms", 0), polling.get("paused_max_ms", 0)))
+    print("   O dispositivo reinicia na nova imagem em 2 segundos")
+
+def upload_ota_callback(*args, **kwargs):
+    """Upload do firmware pela rede (POST /api/update)"""
+    upload_ota(env.subst("$BUILD_DIR/${PROGNAME}.bin"), "firmware")
+
+def upload_fs_ota_callback(*args, **kwargs):
+    """Upload do filesystem pela rede (gere antes com: pio run -t buildfs)"""
+    if env.get("PIOPLATFORM") == "espressif8266":
+        print("\n❌ ERRO: no ESP8266 o filesystem guarda as configurações; use: pio run -t uploadfs")
+        sys.exit(1)
+    upload_ota(env.subst("$BUILD_DIR/littlefs.bin"), "filesystem")
+
 # Registrar custom target
 env.AddCustomTarget(
     name="uploadall",
@@ -49,5 +110,23 @@ env.AddCustomTarget(
     description="Upload filesystem and firmware sequentially"
 )
 
+env.AddCustomTarget(
+    name="uploadota",
+    dependencies="$BUILD_DIR/${PROGNAME}.bin",
+    actions=upload_ota_callback,
+    title="Upload OTA",
+    description="Upload firmware over Wi-Fi through /api/update"
+)
+
+env.AddCustomTarget(
+    name="uploadfsota",
+    dependencies=None,
+    actions=upload_fs_ota_callback,
+    title="Upload Filesystem OTA",
+    description="Upload the LittleFS image over Wi-Fi through /api/update"
+)
+
 print("✨ Custom targets disponíveis:")
-print("  • pio run -t uploadall  → Upload completo (filesystem + firmware)")
+print("  • pio run -t uploadall    → Upload completo (filesystem + firmware)")
+print("  • pio run -t uploadota    → Firmware pela rede (/api/update)")
+print("  • pio run -t uploadfsota  → Filesystem pela rede (após pio run -t buildfs)")
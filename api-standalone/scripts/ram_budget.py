@@ -0,0 +1,32 @@
+"""
+PlatformIO RAM budget check
+Falha o build se a RAM estática do firmware (.data + .rodata + .bss)
+passar de custom_ram_budget (bytes) no ambiente do platformio.ini
+"""
+
+Import("env")
+import subprocess
+
+RAM_SECTIONS = (".data", ".rodata", ".bss")
+
+def check_ram_budget(source, target, env):
+    budget = int(env.GetProjectOption("custom_ram_budget", "0"))
+    if not budget:
+        return 0
+
+    elf = str(target[0])
+    output = subprocess.check_output([env.subst("$SIZETOOL"), "-A", elf]).decode()
+    used = 0
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0] in RAM_SECTIONS:
+            used += int(fields[1])
+
+    print("📊 RAM estática: %d de %d bytes (%s)" % (used, budget, ", ".join(RAM_SECTIONS)))
+    if used > budget:
+        print("❌ ERRO: RAM estática excede custom_ram_budget em %d bytes!" % (used - budget))
+        print("   Reduza os buffers do perfil enxuto em src/config.h (LEAN_PROFILE)")
+        return 1
+    return 0
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", check_ram_budget)
@@ -0,0 +1,114 @@
+#ifndef BURST_CAPTURE_H
+#define BURST_CAPTURE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+
+// ============================================
+// Burst capture ring
+// ============================================
+// Preallocated ring of (timestamp, raw register values) samples. While armed
+// it keeps overwriting the oldest sample, so at trigger time it already holds
+// the pre-trigger history; after the trigger it records just enough samples
+// to leave `preSamples` before the trigger sample and the rest after it, then
+// freezes until re-armed or cancelled.
+//
+// Only the loop task pushes samples. HTTP handlers read it once CAPTURED
+// (frozen) and only change state through arm()/cancel()/requestTrigger().
+// The state is atomic and stored last, so a task that sees it change also
+// sees everything written before it (here and by the caller).
+
+template <uint8_t Channels, uint16_t Capacity>
+class BurstRing {
+ public:
+  enum State { IDLE, ARMED, TRIGGERED, CAPTURED };
+
+  void arm(uint16_t preSamples) {
+    head_ = 0;
+    count_ = 0;
+    total_ = 0;
+    preSamples_ = preSamples < Capacity ? preSamples : Capacity - 1;
+    triggerPending_ = false;
+    state_ = ARMED;  // Last: publishes the fields above to the loop task
+  }
+
+  void cancel() {
+    state_ = IDLE;
+    triggerPending_ = false;
+  }
+
+  // Stop a capture that cannot go on: a triggered one is kept as far as it
+  // got (fewer samples after the trigger), an armed one is dropped
+  void abandon() {
+    if (state_ == TRIGGERED) {
+      state_ = CAPTURED;
+    } else {
+      cancel();
+    }
+  }
+
+  // Trigger on the next pushed sample
+  void requestTrigger() {
+    if (state_ == ARMED) triggerPending_ = true;
+  }
+
+  void push(uint32_t us, const uint16_t *values) {
+    if (state_ != ARMED && state_ != TRIGGERED) return;
+
+    times_[head_] = us;
+    memcpy(values_[head_], values, sizeof(values_[head_]));
+    head_ = (head_ + 1) % Capacity;
+    if (count_ < Capacity) count_++;
+    total_++;
+
+    if (state_ == ARMED && triggerPending_) {
+      triggerPending_ = false;
+      triggerSample_ = total_ - 1;
+      postRemaining_ = Capacity - preSamples_ - 1;
+      state_ = postRemaining_ ? TRIGGERED : CAPTURED;
+    } else if (state_ == TRIGGERED && --postRemaining_ == 0) {
+      state_ = CAPTURED;
+    }
+  }
+
+  State state() const { return state_; }
+  bool active() const {
+    State state = state_;
+    return state == ARMED || state == TRIGGERED;
+  }
+  uint16_t count() const { return count_; }
+  uint16_t preSamples() const { return preSamples_; }
+  static constexpr uint16_t capacity() { return Capacity; }
+  static constexpr uint8_t channels() { return Channels; }
+
+  // Samples are addressed in chronological order, 0 = oldest
+  const uint16_t *values(uint16_t i) const { return values_[slot(i)]; }
+  uint32_t timeUs(uint16_t i) const { return times_[slot(i)]; }
+
+  // Chronological index of the trigger sample (valid once CAPTURED)
+  uint16_t triggerIndex() const { return triggerSample_ - (total_ - count_); }
+
+  // Time of sample i relative to the trigger sample
+  int32_t offsetUs(uint16_t i) const {
+    return (int32_t)(timeUs(i) - timeUs(triggerIndex()));
+  }
+
+ private:
+  uint16_t slot(uint16_t i) const {
+    return (head_ + Capacity - count_ + i) % Capacity;
+  }
+
+  uint32_t times_[Capacity];
+  uint16_t values_[Capacity][Channels];
+  uint16_t head_ = 0;
+  uint16_t count_ = 0;
+  uint32_t total_ = 0;          // Samples pushed since arm()
+  uint32_t triggerSample_ = 0;  // Value of total_ - 1 at the trigger sample
+  uint16_t preSamples_ = 0;
+  uint16_t postRemaining_ = 0;
+  std::atomic<bool> triggerPending_{false};
+  std::atomic<State> state_{IDLE};
+};
+
+#endif // BURST_CAPTURE_H
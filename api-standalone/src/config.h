@@ -7,6 +7,20 @@
 #define DEVICE_NAME "MUST-Inverter-API"
 #define FIRMWARE_VERSION "1.0.0"
 
+// ============================================
+// Build Profile
+// ============================================
+// LEAN_PROFILE shrinks the static buffers and history for the ESP8266
+// (ESP-01) build, which has about 40 KB of heap once Wi-Fi and the TCP
+// stack are up. On by default for ESP8266, off for the ESP32 variants.
+#ifndef LEAN_PROFILE
+  #ifdef ESP8266
+    #define LEAN_PROFILE 1
+  #else
+    #define LEAN_PROFILE 0
+  #endif
+#endif
+
 // ============================================
 // WiFi AP Configuration
 // ============================================
@@ -15,6 +29,7 @@
 #define AP_CHANNEL 1
 #define AP_HIDDEN false
 #define AP_MAX_CLIENTS 4
+#define WIFI_CONNECT_TIMEOUT_MS 10000  // Saved network, before falling back to the portal
 
 // Static IP for AP mode
 #define AP_IP_ADDRESS IPAddress(192, 168, 4, 1)
@@ -30,10 +45,19 @@
 // ============================================
 // RS485/Modbus Configuration
 // ============================================
-// Pin configuration varies by ESP32 variant
-#if defined(CONFIG_IDF_TARGET_ESP32C3)
-  // ESP32-C3: Only has Serial and Serial1
-  #define MODBUS_SERIAL Serial1
+// Pin configuration varies by board
+#if defined(ESP8266)
+  // ESP8266 / ESP-01: UART0 (GPIO1/GPIO3) is the only UART with RX, so it
+  // carries Modbus and the logs move to UART1 (TX only, GPIO2).
+  // No spare GPIO for DE/RE: use an auto-direction RS485 module.
+  #define MODBUS_SERIAL Serial
+  #define MODBUS_TX_PIN 1
+  #define MODBUS_RX_PIN 3
+  #define LOG_PORT Serial1
+
+#elif defined(CONFIG_IDF_TARGET_ESP32C3)
+  // ESP32-C3: Only has UART0 and UART1
+  #define MODBUS_UART_NUM 1
   #define MODBUS_TX_PIN 21
   #define MODBUS_RX_PIN 20
   // Optional: Control DE/RE pins for RS485 transceiver
@@ -42,7 +66,7 @@
   
 #elif defined(CONFIG_IDF_TARGET_ESP32S3)
   // ESP32-S3: Has Serial, Serial1, Serial2
-  #define MODBUS_SERIAL Serial1
+  #define MODBUS_UART_NUM 1
   #define MODBUS_TX_PIN 17
   #define MODBUS_RX_PIN 18
   // Optional: Control DE/RE pins for RS485 transceiver
@@ -51,7 +75,7 @@
   
 #else
   // ESP32 original: Has Serial, Serial1, Serial2
-  #define MODBUS_SERIAL Serial2
+  #define MODBUS_UART_NUM 2
   #define MODBUS_TX_PIN 19
   #define MODBUS_RX_PIN 18
   // Optional: Control DE/RE pins for RS485 transceiver
@@ -61,14 +85,43 @@
 
 #define MODBUS_BAUD 19200
 #define MODBUS_SLAVE_ID 0x04
+#define MODBUS_EP3000_SLAVE_ID 10      // EP3000Plus protocol 1.0 answers on its own id
 #define MODBUS_TIMEOUT_MS 1000
 #define MODBUS_READ_INTERVAL_MS 20000  // 20 seconds
+#define PROFILE_PROBE_RETRY_MS 30000   // Model probe retry while nothing answered it
+
+// RTU master (src/modbus_rtu.h)
+#define MODBUS_RX_TIMEOUT_CHARS 3        // End of frame: under t3.5, so an echo never runs into the answer
+#if LEAN_PROFILE
+  #define MODBUS_FRAME_SIZE 64           // Up to 29 registers per read
+#else
+  #define MODBUS_FRAME_SIZE 256          // Largest RTU frame
+#endif
+#define MODBUS_FRAME_POOL 2              // Request + response of the one transaction in flight
+#define MODBUS_UART_RX_BUFFER 512        // UART driver ring buffer
+#define MODBUS_UART_EVENT_QUEUE 16
+#define MODBUS_EVENT_TASK_STACK 3072
+#define MODBUS_EVENT_TASK_PRIORITY 10    // Above loop() (1) and async_tcp (3)
 
 // If DE/RE pins are defined, enable flow control
 #if defined(MODBUS_DE_PIN) && defined(MODBUS_RE_PIN)
   #define MODBUS_FLOW_CONTROL_ENABLED
 #endif
 
+// ============================================
+// Serial Log
+// ============================================
+#ifndef LOG_PORT
+  #define LOG_PORT Serial
+#endif
+
+// Log strings stay in flash on the ESP8266 (F() for print/println)
+#ifdef ESP8266
+  #define LOG_PRINTF(fmt, ...) LOG_PORT.printf_P(PSTR(fmt), ##__VA_ARGS__)
+#else
+  #define LOG_PRINTF(fmt, ...) LOG_PORT.printf(fmt, ##__VA_ARGS__)
+#endif
+
 // ============================================
 // Reset Button Configuration
 // ============================================
@@ -81,6 +134,100 @@
 #define WEB_SERVER_PORT 80
 #define ENABLE_CORS true
 
+// Request path memory (static, sized at compile time - see static_pool.h)
+#if LEAN_PROFILE
+  // The reports share the regular arena and slots; /api/status is compact.
+  // ArduinoJson 7 takes its slots in 1 KB pools (128 x 8 bytes on 32-bit)
+  // and copies every non-literal string: /api/status is ~300 slots (the
+  // routes array alone is 15 x 11) plus ~1.3 KB of strings, ~4.4 KB, and
+  // the full /api/stats ~4.1 KB. An overflow is answered with a 500 and
+  // counted under memory.json_arena.failures.
+  #define JSON_ARENA_SIZE 6144
+  #define RESPONSE_BUFFER_SIZE 3072
+  #define RESPONSE_POOL_SLOTS 2
+#else
+  #define JSON_ARENA_SIZE 8192              // Arena backing request JsonDocuments
+  #define RESPONSE_BUFFER_SIZE 4096         // Largest serialized JSON response (/api/status)
+  #define RESPONSE_POOL_SLOTS AP_MAX_CLIENTS  // Responses in flight at once
+  #define LARGE_ARENA_SIZE 16384            // /api/stats and /api/debug/profile reports
+  #define LARGE_RESPONSE_SIZE 8192          // (one at a time, own arena and slot)
+#endif
+#define CREDENTIAL_MAX_LEN 41             // Matches the WiFiManager field length + NUL
+#define SSID_MAX_LEN 33                   // 32 chars + NUL (802.11 limit)
+
+// Ceiling for the static buffers above and below, checked at compile time
+// in main.cpp. The ESP8266 build also checks the linked image against
+// custom_ram_budget in platformio.ini (scripts/ram_budget.py).
+#if LEAN_PROFILE
+  // 6 KB arena + 2 x 3 KB slots + 4 KB stats + 1.5 KB burst ring and the
+  // rest: ~19.8 KB, ~20.7 KB with the profiler's loop histograms. Sums of
+  // sizeof, not measurements: what the heap keeps is free_heap in
+  // /api/status, and the linked total is printed by ram_budget.py.
+  #define STATIC_RAM_BUDGET 22528
+#else
+  #define STATIC_RAM_BUDGET 131072
+#endif
+
+// ============================================
+// Rolling Statistics (/api/stats)
+// ============================================
+#if LEAN_PROFILE
+  #define STATS_WINDOWS_S {300}           // 5 minutes only
+  #define STATS_WINDOW_COUNT 1
+  #define STATS_SLOTS_PER_WINDOW 5
+#else
+  #define STATS_WINDOWS_S {60, 300, 3600} // Window lengths: 1, 5 and 60 minutes
+  #define STATS_WINDOW_COUNT 3
+  #define STATS_SLOTS_PER_WINDOW 12       // Resolution: window length / slots
+#endif
+
+// ============================================
+// Burst Capture (/api/burst)
+// ============================================
+// Fields (as in /api/sensors) polled back-to-back while a burst capture is
+// armed; registers and scales come from the detected inverter profile
+#define BURST_CHANNELS { \
+  "inverter.ac_power", \
+  "inverter.ac_current", \
+  "battery.current", \
+  "inverter.dc_voltage", \
+}
+#define BURST_CHANNEL_COUNT 4
+#if LEAN_PROFILE
+  #define BURST_RING_SAMPLES 128
+  #define BURST_DEFAULT_PRE_SAMPLES 32
+#else
+  #define BURST_RING_SAMPLES 512          // 512 x (4 + 2 x channels) bytes
+  #define BURST_DEFAULT_PRE_SAMPLES 128   // History kept before the trigger
+#endif
+#define BURST_ARM_TIMEOUT_S 600           // Give the bus back if nothing triggers
+#define BURST_MAX_FAILED_READS 5          // In a row: the inverter stopped answering
+
+// ============================================
+// Firmware Update (/api/update)
+// ============================================
+// ESP32: a new image that has not polled the inverter by then is treated as
+// broken and the previous one is booted again
+#define OTA_VERIFY_TIMEOUT_S 600
+#define OTA_POLL_INTERVAL_MS 15000        // Inverter poll while an image is coming in
+
+// ============================================
+// Latency Profiler (/api/debug/profile)
+// ============================================
+// Off by default; enable with build_flags = -DPROFILER_ENABLED=1
+#ifndef PROFILER_ENABLED
+  #define PROFILER_ENABLED 0
+#endif
+#if LEAN_PROFILE
+  // Loop stages only (6 x 160 bytes): the per-route histograms would take
+  // another 2.4 KB and their report would not fit a 3 KB response slot
+  #define PROFILER_HTTP_ROUTES 0
+  #define PROFILER_SLOWEST_SAMPLES 4
+#else
+  #define PROFILER_HTTP_ROUTES 1            // Per-route histograms (async_tcp task)
+  #define PROFILER_SLOWEST_SAMPLES 8        // Slowest samples kept per histogram
+#endif
+
 // ============================================
 // EEPROM/Preferences Configuration
 // ============================================
@@ -88,6 +235,14 @@
 #define PREFS_KEY_API_USER "api_user"
 #define PREFS_KEY_API_PASS "api_pass"
 #define PREFS_KEY_WIFI_CONFIGURED "wifi_cfg"
+#define PREFS_KEY_PROFILE_NAME "profile"      // Detected inverter profile
+#define PREFS_KEY_PROFILE_SIGNATURE "prof_sig"  // Probe signature it was detected with
+
+// ESP8266: settings live in LittleFS (settings_store.h), one file per
+// namespace with a fixed number of entries
+#define SETTINGS_MAX_KEYS 4
+#define SETTINGS_KEY_LEN 16               // NVS key limit (15 chars + NUL)
+#define SETTINGS_VALUE_LEN 65             // Wi-Fi password: 64 chars + NUL
 
 // ============================================
 // Demo Mode Configuration
@@ -1,17 +1,28 @@
 #include <Arduino.h>
+#ifdef ESP8266
+#include <ESP8266WiFi.h>
+#include <Updater.h>
+#else
 #include <WiFi.h>
+#include <Update.h>
+#include <esp_ota_ops.h>
+#endif
 #include <WiFiManager.h>
 #include <ESPAsyncWebServer.h>
-#include <Preferences.h>
-#include <ModbusRTU.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
 #include "config.h"
+#include "modbus_rtu.h"
+#include "settings_store.h"
+#include "static_pool.h"
+#include "profiler.h"
+#include "rolling_stats.h"
+#include "burst_capture.h"
 
 // ==================== GLOBAL OBJECTS ====================
 AsyncWebServer server(80);
-Preferences prefs;
-ModbusRTU modbus;
+SettingsStore prefs;
+ModbusRtuMaster modbus;
 WiFiManager wifiManager;
 
 // Factory reset button
@@ -20,8 +31,111 @@ unsigned long resetButtonPressed = 0;
 bool resetInProgress = false;
 
 // Dynamic credentials (loaded from Preferences)
-String currentApiUser = DEFAULT_API_USER;
-String currentApiPass = DEFAULT_API_PASS;
+char currentApiUser[CREDENTIAL_MAX_LEN] = DEFAULT_API_USER;
+char currentApiPass[CREDENTIAL_MAX_LEN] = DEFAULT_API_PASS;
+
+// SSID of the station link, cached once connected so handlers need no String
+char connectedSSID[SSID_MAX_LEN] = "";
+
+// Boot milestones, in millis() since power-on (0 = not reached yet)
+struct BootTiming {
+  unsigned long modbusReadyMs;
+  unsigned long firstPollMs;
+  unsigned long firstSampleMs;   // First poll that got real inverter data
+  unsigned long wifiConnectedMs;
+  unsigned long httpReadyMs;
+};
+
+BootTiming bootTiming = {0};
+
+// ==================== REQUEST PATH MEMORY ====================
+JsonArena<JSON_ARENA_SIZE> jsonArena;
+ResponsePool<RESPONSE_BUFFER_SIZE, RESPONSE_POOL_SLOTS> responsePool;
+
+#if LEAN_PROFILE
+// Lean build: the reports use the regular arena and slots. Handlers never
+// overlap and each one is done with its document before it returns.
+JsonArena<JSON_ARENA_SIZE> &largeArena = jsonArena;
+ResponsePool<RESPONSE_BUFFER_SIZE, RESPONSE_POOL_SLOTS> &largeResponsePool = responsePool;
+#else
+// Reports that outgrow the regular arena and response slots
+JsonArena<LARGE_ARENA_SIZE> largeArena;
+ResponsePool<LARGE_RESPONSE_SIZE, 1> largeResponsePool;
+#endif
+
+enum RouteId {
+  ROUTE_ROOT,
+  ROUTE_SENSORS,
+  ROUTE_STATUS,
+  ROUTE_CREDENTIALS_GET,
+  ROUTE_CREDENTIALS_POST,
+  ROUTE_WIFI_SCAN,
+  ROUTE_STATS,
+  ROUTE_BURST,
+  ROUTE_BURST_ARM,
+  ROUTE_BURST_TRIGGER,
+  ROUTE_BURST_CANCEL,
+  ROUTE_BURST_DATA,
+  ROUTE_UPDATE_GET,
+  ROUTE_UPDATE_POST,
+#if PROFILER_ENABLED
+  ROUTE_DEBUG_PROFILE,
+#endif
+  ROUTE_COUNT
+};
+
+RouteStats routeStats[ROUTE_COUNT] = {
+  {"/", 0, 0, 0, 0},
+  {"/api/sensors", 0, 0, 0, 0},
+  {"/api/status", 0, 0, 0, 0},
+  {"/api/credentials:get", 0, 0, 0, 0},
+  {"/api/credentials:post", 0, 0, 0, 0},
+  {"/api/wifi/scan", 0, 0, 0, 0},
+  {"/api/stats", 0, 0, 0, 0},
+  {"/api/burst", 0, 0, 0, 0},
+  {"/api/burst/arm", 0, 0, 0, 0},
+  {"/api/burst/trigger", 0, 0, 0, 0},
+  {"/api/burst/cancel", 0, 0, 0, 0},
+  {"/api/burst/data", 0, 0, 0, 0},
+  {"/api/update:get", 0, 0, 0, 0},
+  {"/api/update:post", 0, 0, 0, 0},
+#if PROFILER_ENABLED
+  {"/api/debug/profile", 0, 0, 0, 0},
+#endif
+};
+
+// ==================== PROFILER ====================
+#if PROFILER_ENABLED
+enum LoopStage {
+  LOOP_CYCLE,
+  LOOP_FACTORY_RESET,
+  LOOP_WIFI,
+  LOOP_SENSOR_UPDATE,
+  LOOP_BURST_SAMPLE,
+  LOOP_MODBUS_TRANSACTION,
+  LOOP_STAGE_COUNT
+};
+
+const char *const loopStageNames[LOOP_STAGE_COUNT] = {
+  "cycle",
+  "factory_reset",
+  "wifi",
+  "sensor_update",
+  "burst_sample",
+  "modbus_transaction",
+};
+
+// Written only by the loop task
+ProfileHistogram loopProfile[LOOP_STAGE_COUNT] = {};
+#endif
+
+#if PROFILER_ENABLED && PROFILER_HTTP_ROUTES
+// Written only by the async_tcp task
+ProfileHistogram httpProfile[ROUTE_COUNT] = {};
+#define PROFILE_ROUTE(route) PROFILE_SCOPE(httpProfile[route])
+#else
+#define PROFILE_ROUTE(route)
+#endif
 
 // ==================== SENSOR DATA STRUCTURE ====================
 struct SensorData {
@@ -63,13 +177,189 @@ struct SensorData {
   bool modbusError;
   bool demoMode;
   int failedReadCount;
+  
+  // Poll timing (reported in /api/status)
+  unsigned long lastPollStart;
+  unsigned long pollDurationMs;     // Time spent in the last updateSensorData()
+  unsigned long pollDurationMaxMs;
+  unsigned long pollIntervalMs;     // Start-to-start time of the last two polls
 };
 
 SensorData sensorData = {0};
 
+// ==================== SENSOR FIELD TABLE ====================
+// Every field /api/sensors can return, in output order (grouped by section).
+// Values are rounded to their published precision once per poll, and each
+// field keeps the snapshot sequence in which it last changed, so ?since=
+// never has to diff documents per request.
+enum FieldKind {
+  FIELD_FLOAT,
+  FIELD_MODE_TEXT,
+  FIELD_MODE_ID
+};
+
+struct SensorField {
+  const char *section;
+  const char *key;
+  FieldKind kind;
+  float SensorData::*value;  // FIELD_FLOAT only
+  uint8_t decimals;
+};
+
+constexpr SensorField sensorFields[] = {
+  {"charger", "voltage", FIELD_FLOAT, &SensorData::chargerVoltage, 1},
+  {"charger", "current", FIELD_FLOAT, &SensorData::chargerCurrent, 2},
+  {"charger", "power", FIELD_FLOAT, &SensorData::chargerPower, 0},
+  {"charger", "accumulated_power", FIELD_FLOAT, &SensorData::chargerAccumulatedPower, 1},
+  
+  {"pv", "voltage", FIELD_FLOAT, &SensorData::pvVoltage, 1},
+  {"pv", "current", FIELD_FLOAT, &SensorData::pvCurrent, 2},
+  {"pv", "power", FIELD_FLOAT, &SensorData::pvPower, 0},
+  
+  {"battery", "voltage", FIELD_FLOAT, &SensorData::batteryVoltage, 1},
+  {"battery", "current", FIELD_FLOAT, &SensorData::batteryCurrent, 2},
+  {"battery", "power", FIELD_FLOAT, &SensorData::batteryPower, 0},
+  {"battery", "soc", FIELD_FLOAT, &SensorData::batterySOC, 0},
+  {"battery", "temperature", FIELD_FLOAT, &SensorData::batteryTemp, 1},
+  
+  {"inverter", "mode", FIELD_MODE_TEXT, nullptr, 0},
+  {"inverter", "mode_id", FIELD_MODE_ID, nullptr, 0},
+  {"inverter", "ac_voltage", FIELD_FLOAT, &SensorData::acVoltage, 1},
+  {"inverter", "ac_current", FIELD_FLOAT, &SensorData::acCurrent, 2},
+  {"inverter", "ac_frequency", FIELD_FLOAT, &SensorData::acFrequency, 2},
+  {"inverter", "ac_power", FIELD_FLOAT, &SensorData::acPower, 0},
+  {"inverter", "load_percent", FIELD_FLOAT, &SensorData::loadPercent, 0},
+  {"inverter", "dc_voltage", FIELD_FLOAT, &SensorData::dcVoltage, 1},
+  {"inverter", "max_charge_current", FIELD_FLOAT, &SensorData::maxChargeCurrent, 0},
+  {"inverter", "max_discharge_current", FIELD_FLOAT, &SensorData::maxDischargeCurrent, 0},
+  {"inverter", "accumulated_power", FIELD_FLOAT, &SensorData::acDischargerAccumulatedPower, 1},
+  
+  {"totals", "total_charged", FIELD_FLOAT, &SensorData::totalChargerPower, 1},
+  {"totals", "total_discharged", FIELD_FLOAT, &SensorData::totalDischargerPower, 1},
+  {"totals", "device_temperature", FIELD_FLOAT, &SensorData::deviceTemp, 1},
+};
+
+constexpr size_t SENSOR_FIELD_COUNT = sizeof(sensorFields) / sizeof(sensorFields[0]);
+static_assert(SENSOR_FIELD_COUNT <= 32, "field selection is a 32-bit mask");
+const uint32_t ALL_SENSOR_FIELDS = SENSOR_FIELD_COUNT == 32 ? 0xFFFFFFFFu : (1u << SENSOR_FIELD_COUNT) - 1;
+
+uint32_t snapshotSeq = 0;                          // Bumped by every poll that changed something
+uint32_t snapshotBootId = 0;                       // Random per boot, see publishedSeq()
+uint32_t fieldChangeSeq[SENSOR_FIELD_COUNT] = {0}; // Snapshot in which each field last changed
+double publishedValues[SENSOR_FIELD_COUNT] = {0};  // Rounded values served by /api/sensors
+
+double readSensorField(const SensorField &field) {
+  static const int scales[] = {1, 10, 100};
+  if (field.kind != FIELD_FLOAT) return sensorData.inverterMode;
+  return round(sensorData.*field.value * scales[field.decimals]) / (double)scales[field.decimals];
+}
+
+// The "seq" clients see carries the boot id above the counter, so a sequence
+// kept from before a reboot never matches one of this boot. 21 bits of id
+// keep it below 2^53, exact as a JavaScript number.
+void initSnapshotSeq() {
+#ifdef ESP8266
+  uint32_t random = RANDOM_REG32;
+#else
+  uint32_t random = esp_random();
+#endif
+  snapshotBootId = random % ((1u << 21) - 1) + 1;
+}
+
+uint64_t publishedSeq() {
+  return ((uint64_t)snapshotBootId << 32) | snapshotSeq;
+}
+
+// Called after every poll (real or demo data)
+void publishSensorSnapshot() {
+  uint32_t nextSeq = snapshotSeq + 1;
+  bool changed = false;
+  
+  for (size_t i = 0; i < SENSOR_FIELD_COUNT; i++) {
+    double value = readSensorField(sensorFields[i]);
+    if (fieldChangeSeq[i] == 0 || value != publishedValues[i]) {
+      publishedValues[i] = value;
+      fieldChangeSeq[i] = nextSeq;
+      changed = true;
+    }
+  }
+  
+  if (changed) snapshotSeq = nextSeq;
+}
+
+// "battery" selects a whole section, "battery.soc" a single field
+bool fieldMatches(const SensorField &field, const char *name, size_t len) {
+  size_t sectionLen = strlen(field.section);
+  if (len < sectionLen || strncmp(name, field.section, sectionLen) != 0) return false;
+  if (len == sectionLen) return true;
+  
+  size_t keyLen = len - sectionLen - 1;
+  return name[sectionLen] == '.' && strlen(field.key) == keyLen &&
+         strncmp(name + sectionLen + 1, field.key, keyLen) == 0;
+}
+
+// Parse a comma separated field list into a bitmask over sensorFields.
+// Returns false if any name is unknown or nothing was selected.
+bool parseFieldSelection(const char *list, uint32_t *selected) {
+  *selected = 0;
+  while (*list) {
+    const char *end = strchr(list, ',');
+    size_t len = end ? (size_t)(end - list) : strlen(list);
+    
+    if (len > 0) {
+      uint32_t matched = 0;
+      for (size_t i = 0; i < SENSOR_FIELD_COUNT; i++) {
+        if (fieldMatches(sensorFields[i], list, len)) matched |= 1u << i;
+      }
+      if (!matched) return false;
+      *selected |= matched;
+    }
+    
+    if (!end) break;
+    list = end + 1;
+  }
+  return *selected != 0;
+}
+
+// ==================== ROLLING STATISTICS ====================
+// Sliding-window stats for every numeric field of the table above
+constexpr size_t countNumericFields(size_t i = 0) {
+  return i == SENSOR_FIELD_COUNT ? 0 : (sensorFields[i].kind == FIELD_FLOAT) + countNumericFields(i + 1);
+}
+constexpr size_t STATS_FIELD_COUNT = countNumericFields();
+
+const uint32_t statsWindowSeconds[STATS_WINDOW_COUNT] = STATS_WINDOWS_S;
+uint8_t statsFieldIndex[STATS_FIELD_COUNT];  // Stats row -> sensorFields index
+RollingWindow<STATS_SLOTS_PER_WINDOW> rollingStats[STATS_FIELD_COUNT][STATS_WINDOW_COUNT];
+unsigned long statsLastSampleMs = 0;  // Last poll fed in (0 = none yet)
+
+void initRollingStats() {
+  size_t next = 0;
+  for (size_t i = 0; i < SENSOR_FIELD_COUNT; i++) {
+    if (sensorFields[i].kind == FIELD_FLOAT) statsFieldIndex[next++] = i;
+  }
+  for (size_t row = 0; row < STATS_FIELD_COUNT; row++) {
+    for (int w = 0; w < STATS_WINDOW_COUNT; w++) {
+      rollingStats[row][w].begin(statsWindowSeconds[w] * 1000UL / STATS_SLOTS_PER_WINDOW);
+    }
+  }
+}
+
+// Feed the raw (unrounded) values of a fresh poll, O(1) per field and window
+void updateRollingStats() {
+  unsigned long now = millis();
+  statsLastSampleMs = now;
+  for (size_t row = 0; row < STATS_FIELD_COUNT; row++) {
+    float value = sensorData.*sensorFields[statsFieldIndex[row]].value;
+    for (int w = 0; w < STATS_WINDOW_COUNT; w++) {
+      rollingStats[row][w].add(value, now);
+    }
+  }
+}
+
 // ==================== DEMO MODE FUNCTIONS ====================
 void generateDemoData() {
-  Serial.println("Generating demo data - Inverter not connected");
+  LOG_PORT.println(F("Generating demo data - Inverter not connected"));
   
   // Simulate realistic solar inverter values
   unsigned long time = millis() / 1000;
@@ -119,50 +409,385 @@ void generateDemoData() {
   sensorData.demoMode = true;
 }
 
+// ==================== INVERTER PROFILES ====================
+// Every register the poll can read, in one table. A profile enables the
+// points its model actually has (so missing registers never cost a timeout)
+// and may move a point to another address. Profiles are picked at boot by
+// reading a few identifying registers; the result is cached in NVS keyed by
+// the probe signature, so later boots poll with the cached profile right
+// away and only re-check the signature once the inverter has answered.
+//
+// The tables are PROGMEM (flash on the ESP8266, where plain const data is
+// copied to RAM) and are only read through memcpy_P/pgm_read_*; the active
+// profile and its point map are RAM copies.
+enum RegisterPointId {
+  REG_CHARGER_VOLTAGE,
+  REG_CHARGER_CURRENT,
+  REG_CHARGER_POWER,
+  REG_PV_VOLTAGE,
+  REG_PV_CURRENT,
+  REG_PV_POWER,
+  REG_BATTERY_VOLTAGE,
+  REG_BATTERY_CURRENT,
+  REG_BATTERY_POWER,
+  REG_BATTERY_SOC,
+  REG_BATTERY_TEMP,
+  REG_DEVICE_TEMP,
+  REG_INVERTER_MODE,
+  REG_AC_VOLTAGE,
+  REG_AC_CURRENT,
+  REG_AC_FREQUENCY,
+  REG_AC_POWER,
+  REG_LOAD_PERCENT,
+  REG_DC_VOLTAGE,
+  REG_MAX_CHARGE_CURRENT,
+  REG_MAX_DISCHARGE_CURRENT,
+  REG_CHARGER_ACCUMULATED,
+  REG_DISCHARGER_ACCUMULATED,
+  REG_AC_CHARGER_ACCUMULATED,
+  REG_AC_DISCHARGER_ACCUMULATED,
+  REG_POINT_COUNT
+};
+
+struct RegisterPoint {
+  float SensorData::*value;  // nullptr = inverterMode (integer)
+  uint16_t address;
+  float scale;
+  float offset;
+  bool wide;                 // 32-bit: high word at address, low word at address + 1
+};
+
+// Default map, in poll order; the first enabled point doubles as the
+// connection test
+const RegisterPoint registerMap[REG_POINT_COUNT] PROGMEM = {
+  // Charger Stats (15201-15221)
+  {&SensorData::chargerVoltage, 15201, 0.1, 0, false},       // V
+  {&SensorData::chargerCurrent, 15202, 0.01, 0, false},      // A
+  {&SensorData::chargerPower, 15203, 1.0, 0, false},         // W
+  {&SensorData::pvVoltage, 15205, 0.1, 0, false},            // V
+  {&SensorData::pvCurrent, 15206, 0.01, 0, false},           // A
+  {&SensorData::pvPower, 15207, 1.0, 0, false},              // W
+  {&SensorData::batteryVoltage, 15213, 0.1, 0, false},       // V
+  {&SensorData::batteryCurrent, 15214, 0.01, 0, false},      // A
+  {&SensorData::batteryPower, 15215, 1.0, 0, false},         // W
+  {&SensorData::batterySOC, 15219, 1.0, 0, false},           // %
+  {&SensorData::batteryTemp, 15221, 0.1, -100.0, false},     // °C
+  {&SensorData::deviceTemp, 15220, 0.1, -100.0, false},      // °C
+  
+  // Inverter Stats (25201-25274)
+  {nullptr, 25201, 1.0, 0, false},                           // Mode
+  {&SensorData::acVoltage, 25205, 0.1, 0, false},            // V
+  {&SensorData::acCurrent, 25206, 0.01, 0, false},           // A
+  {&SensorData::acFrequency, 25207, 0.01, 0, false},         // Hz
+  {&SensorData::acPower, 25213, 1.0, 0, false},              // W
+  {&SensorData::loadPercent, 25209, 1.0, 0, false},          // %
+  {&SensorData::dcVoltage, 25211, 0.1, 0, false},            // V
+  {&SensorData::maxChargeCurrent, 25235, 1.0, 0, false},     // A
+  {&SensorData::maxDischargeCurrent, 25236, 1.0, 0, false},  // A
+  
+  // Accumulated Power (kWh, 32-bit)
+  {&SensorData::chargerAccumulatedPower, 15231, 0.1, 0, true},
+  {&SensorData::dischargerAccumulatedPower, 15233, 0.1, 0, true},
+  {&SensorData::acChargerAccumulatedPower, 15235, 0.1, 0, true},
+  {&SensorData::acDischargerAccumulatedPower, 15237, 0.1, 0, true},
+};
+
+static_assert(REG_POINT_COUNT <= 32, "profile point selection is a 32-bit mask");
+#define REG_BIT(point) (1u << (point))
+const uint32_t REG_ALL = (1u << REG_POINT_COUNT) - 1;
+const uint32_t REG_ACCUMULATED = REG_BIT(REG_CHARGER_ACCUMULATED) | REG_BIT(REG_DISCHARGER_ACCUMULATED) |
+                                 REG_BIT(REG_AC_CHARGER_ACCUMULATED) | REG_BIT(REG_AC_DISCHARGER_ACCUMULATED);
+
+// Identifying registers read by the probe, in order
+enum ProbeId {
+  PROBE_EP_MACHINE_TYPE,  // 30000: EP3000Plus/EP3300 family only
+  PROBE_MACHINE_HIGH,     // 20000: "PH"/"EP"/"PV" (protocol 1.4.15)
+  PROBE_MACHINE_LOW,      // 20001: 1800/3000/3500
+  PROBE_BMS_SOC,          // 113: battery SOC, PV19 only
+  PROBE_COUNT
+};
+
+struct ProbeRegister {
+  uint8_t slaveId;
+  uint16_t address;
+  bool identifying;  // false: only whether it answers goes into the signature
+};
+
+const ProbeRegister probeRegisters[PROBE_COUNT] PROGMEM = {
+  {MODBUS_EP3000_SLAVE_ID, 30000, true},
+  {MODBUS_SLAVE_ID, 20000, true},
+  {MODBUS_SLAVE_ID, 20001, true},
+  {MODBUS_SLAVE_ID, 113, false},
+};
+
+// Two ASCII characters per register, first one in the high byte
+#define PROBE_ASCII(a, b) (uint16_t)((a) << 8 | (b))
+#define PROBE_READABLE 0xFFFFFFFFu  // Matches any value that could be read
+
+struct ProbeMatch {
+  uint8_t probe;   // PROBE_COUNT = unused
+  uint32_t value;  // Expected value or PROBE_READABLE
+};
+
+struct RegisterOverride {
+  uint8_t point;
+  uint16_t address;
+  float scale;
+  float offset;
+};
+
+struct InverterProfile {
+  const char *name;
+  uint8_t slaveId;             // Modbus device id the model answers on
+  ProbeMatch match[2];         // All used entries must match
+  uint32_t points;             // REG_BIT mask of enabled points
+  const RegisterOverride *overrides;
+  uint8_t overrideCount;
+};
+
+// Protocol 1.4.3 (PV19): SOC from the BMS register the PV19 map uses
+const RegisterOverride pv19Overrides[] PROGMEM = {
+  {REG_BATTERY_SOC, 113, 1.0, 0},
+};
+
+// EP3000Plus protocol 1.0: its own 30000 block
+const RegisterOverride ep3000Overrides[] PROGMEM = {
+  {REG_AC_VOLTAGE, 30007, 1.0, 0},
+  {REG_AC_FREQUENCY, 30008, 0.1, 0},
+  {REG_AC_CURRENT, 30009, 0.1, 0},
+  {REG_AC_POWER, 30010, 1.0, 0},
+  {REG_LOAD_PERCENT, 30012, 1.0, 0},
+  {REG_BATTERY_VOLTAGE, 30014, 0.1, 0},
+  {REG_BATTERY_CURRENT, 30015, 0.1, 0},
+  {REG_BATTERY_TEMP, 30016, 1.0, 0},
+  {REG_BATTERY_SOC, 30017, 1.0, 0},
+  {REG_DEVICE_TEMP, 30018, 1.0, 0},
+};
+
+// 25236 is reserved and 15231-15238 do not exist in the 1.4.x protocols
+const uint32_t PROTOCOL_14X_POINTS = REG_ALL & ~REG_ACCUMULATED & ~REG_BIT(REG_MAX_DISCHARGE_CURRENT);
+#define OVERRIDES(list) list, sizeof(list) / sizeof(list[0])
+
+// First match wins, so the models a machine-type register identifies come
+// before PV19: a PV18 or PH1800 with a BMS answers 113 too. The last entry
+// is the fallback for unknown inverters.
+const InverterProfile inverterProfiles[] PROGMEM = {
+  {"EP3000Plus", MODBUS_EP3000_SLAVE_ID, {{PROBE_EP_MACHINE_TYPE, PROBE_READABLE}, {PROBE_COUNT, 0}},
+   REG_BIT(REG_AC_VOLTAGE) | REG_BIT(REG_AC_FREQUENCY) | REG_BIT(REG_AC_CURRENT) | REG_BIT(REG_AC_POWER) |
+   REG_BIT(REG_LOAD_PERCENT) | REG_BIT(REG_BATTERY_VOLTAGE) | REG_BIT(REG_BATTERY_CURRENT) |
+   REG_BIT(REG_BATTERY_TEMP) | REG_BIT(REG_BATTERY_SOC) | REG_BIT(REG_DEVICE_TEMP),
+   OVERRIDES(ep3000Overrides)},
+  {"PV3500", MODBUS_SLAVE_ID, {{PROBE_MACHINE_HIGH, PROBE_ASCII('P', 'V')}, {PROBE_MACHINE_LOW, 3500}},
+   PROTOCOL_14X_POINTS & ~REG_BIT(REG_BATTERY_SOC), nullptr, 0},
+  {"PH1800", MODBUS_SLAVE_ID, {{PROBE_MACHINE_HIGH, PROBE_ASCII('P', 'H')}, {PROBE_MACHINE_LOW, 1800}},
+   PROTOCOL_14X_POINTS & ~REG_BIT(REG_BATTERY_SOC), nullptr, 0},
+  {"PV18", MODBUS_SLAVE_ID, {{PROBE_MACHINE_LOW, 1800}, {PROBE_COUNT, 0}},
+   PROTOCOL_14X_POINTS & ~REG_BIT(REG_BATTERY_SOC), nullptr, 0},
+  {"PV19", MODBUS_SLAVE_ID, {{PROBE_BMS_SOC, PROBE_READABLE}, {PROBE_COUNT, 0}},
+   PROTOCOL_14X_POINTS, OVERRIDES(pv19Overrides)},
+  {"generic", MODBUS_SLAVE_ID, {{PROBE_COUNT, 0}, {PROBE_COUNT, 0}}, REG_ALL, nullptr, 0},
+};
+
+const size_t INVERTER_PROFILE_COUNT = sizeof(inverterProfiles) / sizeof(inverterProfiles[0]);
+const size_t GENERIC_PROFILE = INVERTER_PROFILE_COUNT - 1;
+
+enum ProfileSource {
+  PROFILE_DEFAULT,   // Generic map, nothing detected yet
+  PROFILE_CACHED,    // From NVS, signature not re-checked yet
+  PROFILE_DETECTED   // Probed (or cached and confirmed) this boot
+};
+
+const char *const profileSourceNames[] = {"default", "cached", "detected"};
+
+// Active map: registerMap with the profile's overrides applied
+RegisterPoint activePoints[REG_POINT_COUNT];
+uint32_t activePointMask = REG_ALL;
+InverterProfile activeProfile;
+ProfileSource profileSource = PROFILE_DEFAULT;
+uint32_t profileSignature = 0;
+uint8_t activeSlaveId = MODBUS_SLAVE_ID;  // Polls and burst reads go here
+bool profileProbePending = true;
+unsigned long profileProbeFailedMs = 0;  // Last probe nobody answered (0 = none)
+
+InverterProfile loadInverterProfile(size_t index) {
+  InverterProfile profile;
+  memcpy_P(&profile, &inverterProfiles[index], sizeof(profile));
+  return profile;
+}
+
+void applyInverterProfile(size_t index) {
+  activeProfile = loadInverterProfile(index);
+  memcpy_P(activePoints, registerMap, sizeof(activePoints));
+  for (uint8_t i = 0; i < activeProfile.overrideCount; i++) {
+    RegisterOverride change;
+    memcpy_P(&change, &activeProfile.overrides[i], sizeof(change));
+    activePoints[change.point].address = change.address;
+    activePoints[change.point].scale = change.scale;
+    activePoints[change.point].offset = change.offset;
+  }
+  activePointMask = activeProfile.points;
+  activeSlaveId = activeProfile.slaveId;
+}
+
+// INVERTER_PROFILE_COUNT if no profile has that name
+size_t findInverterProfile(const char *name) {
+  for (size_t i = 0; i < INVERTER_PROFILE_COUNT; i++) {
+    if (strcmp(loadInverterProfile(i).name, name) == 0) return i;
+  }
+  return INVERTER_PROFILE_COUNT;
+}
+
+// Setup: start from the cached profile, or the generic map
+void initInverterProfile() {
+  applyInverterProfile(GENERIC_PROFILE);
+  
+  char name[16] = "";
+  prefs.begin(PREFS_NAMESPACE, true);
+  profileSignature = prefs.getUInt(PREFS_KEY_PROFILE_SIGNATURE, 0);
+  prefs.getString(PREFS_KEY_PROFILE_NAME, name, sizeof(name));
+  prefs.end();
+  
+  // A cached profile is used without probing; updateSensorData() asks for
+  // a probe again if the inverter stops answering it
+  size_t cached = findInverterProfile(name);
+  if (cached < INVERTER_PROFILE_COUNT) {
+    applyInverterProfile(cached);
+    profileSource = PROFILE_CACHED;
+    profileProbePending = false;
+    LOG_PRINTF("✓ Inverter profile %s (cached, signature %08X)\n", activeProfile.name, profileSignature);
+  } else {
+    LOG_PORT.println(F("Inverter profile not cached - probing before the first poll"));
+  }
+}
+
 // ==================== MODBUS FUNCTIONS ====================
+unsigned long lastModbusUpdate = 0;
+const unsigned long MODBUS_UPDATE_INTERVAL = 5000;  // 5 seconds
+
+// Result of the last readModbusRegister(): a timeout means a silent bus
+ModbusResult lastModbusResult = MODBUS_OK;
+
+bool readSlaveRegister(uint8_t slaveId, uint16_t address, uint16_t* value) {
+  PROFILE_SCOPE(loopProfile[LOOP_MODBUS_TRANSACTION]);
+  lastModbusResult = modbus.readHreg(slaveId, address, value, 1);
+  return lastModbusResult == MODBUS_OK;
+}
+
+// From the device the active profile answers on
 bool readModbusRegister(uint16_t address, uint16_t* value) {
-  if (!modbus.slave()) {
-    modbus.readHreg(MODBUS_SLAVE_ID, address, value, 1);
-    
-    unsigned long timeout = millis() + 1000;
-    while (millis() < timeout) {
-      modbus.task();
-      delay(10);
-      if (modbus.slave() == MODBUS_SLAVE_ID) {
-        return true;
-      }
-    }
-  }
-  return false;
+  return readSlaveRegister(activeSlaveId, address, value);
 }
 
-float readModbusFloat(uint16_t address, float scale = 1.0) {
-  uint16_t value;
-  if (readModbusRegister(address, &value)) {
-    return (float)value * scale;
+// The model probe reads one register per loop pass, so a silent inverter
+// holds the loop (and Wi-Fi bring-up) for one timeout at a time
+struct ProfileProbe {
+  uint8_t step;                 // Next probe register; PROBE_COUNT = generic fallback
+  bool anyReadable;
+  bool readable[PROBE_COUNT];
+  uint16_t values[PROBE_COUNT];
+};
+
+ProfileProbe profileProbe = {};
+
+// All probes read: switch to the matching profile
+void finishInverterProfileProbe() {
+  const ProfileProbe &probe = profileProbe;
+  
+  // FNV-1a over (answered, value) of every probe
+  uint32_t signature = 2166136261u;
+  for (uint8_t i = 0; i < PROBE_COUNT; i++) {
+    uint16_t identity = probe.readable[i] && pgm_read_byte(&probeRegisters[i].identifying) ? probe.values[i] : 0;
+    uint8_t bytes[3] = {probe.readable[i], (uint8_t)(identity >> 8), (uint8_t)identity};
+    for (uint8_t b = 0; b < sizeof(bytes); b++) {
+      signature = (signature ^ bytes[b]) * 16777619u;
+    }
   }
-  return 0.0;
+  profileProbePending = false;
+  
+  if (profileSource == PROFILE_CACHED && signature == profileSignature) {
+    profileSource = PROFILE_DETECTED;
+    LOG_PRINTF("✓ Inverter profile %s confirmed\n", activeProfile.name);
+    return;
+  }
+  
+  size_t profile = GENERIC_PROFILE;
+  for (size_t p = 0; p < GENERIC_PROFILE && profile == GENERIC_PROFILE; p++) {
+    const InverterProfile candidate = loadInverterProfile(p);
+    bool matches = true;
+    for (uint8_t m = 0; m < 2; m++) {
+      const ProbeMatch &match = candidate.match[m];
+      if (match.probe >= PROBE_COUNT) continue;
+      if (!probe.readable[match.probe] ||
+          (match.value != PROBE_READABLE && probe.values[match.probe] != match.value)) {
+        matches = false;
+      }
+    }
+    if (matches) profile = p;
+  }
+  
+  applyInverterProfile(profile);
+  profileSource = PROFILE_DETECTED;
+  profileSignature = signature;
+  
+  prefs.begin(PREFS_NAMESPACE, false);
+  prefs.putUInt(PREFS_KEY_PROFILE_SIGNATURE, signature);
+  prefs.putString(PREFS_KEY_PROFILE_NAME, activeProfile.name);
+  prefs.end();
+  
+  LOG_PRINTF("✓ Inverter profile %s detected (signature %08X, %d registers disabled)\n",
+             activeProfile.name, signature, REG_POINT_COUNT - __builtin_popcount(activeProfile.points));
 }
 
-int readModbusInt(uint16_t address) {
-  uint16_t value;
-  if (readModbusRegister(address, &value)) {
-    return (int)value;
+// One step of the probe; true once it has picked a profile. Leaves
+// profileProbePending set (and starts over after PROFILE_PROBE_RETRY_MS) if
+// the inverter did not answer at all.
+bool stepInverterProfileProbe() {
+  ProfileProbe &probe = profileProbe;
+  if (probe.step < PROBE_COUNT) {
+    uint8_t i = probe.step++;
+    probe.readable[i] = readSlaveRegister(pgm_read_byte(&probeRegisters[i].slaveId),
+                                          pgm_read_word(&probeRegisters[i].address), &probe.values[i]);
+    probe.anyReadable |= probe.readable[i];
+    if (probe.step < PROBE_COUNT || !probe.anyReadable) return false;
+  } else {
+    // Nothing identifying answered: generic map if the charger block does
+    uint16_t value;
+    if (!readSlaveRegister(MODBUS_SLAVE_ID, pgm_read_word(&registerMap[0].address), &value)) {
+      LOG_PRINTF("Inverter profile probe: no answer, retrying in %d s\n", PROFILE_PROBE_RETRY_MS / 1000);
+      profileProbeFailedMs = millis();
+      profileProbe = ProfileProbe();
+      return false;
+    }
   }
-  return 0;
+  
+  finishInverterProfileProbe();
+  profileProbe = ProfileProbe();
+  return true;
 }
 
 void updateSensorData() {
-  Serial.println("Reading Modbus sensors...");
+  LOG_PORT.println(F("Reading Modbus sensors..."));
   
-  // Try to read first register to test connection
+  // The first enabled register doubles as the connection test
+  bool connectionOk = false;
+  uint8_t first = 0;
+  while (first < REG_POINT_COUNT && !(activePointMask & REG_BIT(first))) first++;
   uint16_t testValue;
-  bool connectionOk = readModbusRegister(15201, &testValue);
+  if (first < REG_POINT_COUNT) {
+    connectionOk = readModbusRegister(activePoints[first].address, &testValue);
+  }
   
   if (!connectionOk) {
     sensorData.failedReadCount++;
-    Serial.printf("Modbus read failed (attempt %d/%d)\n", 
-                  sensorData.failedReadCount, DEMO_DETECTION_FAILED_READS);
+    LOG_PRINTF("Modbus read failed (attempt %d/%d)\n",
+               sensorData.failedReadCount, DEMO_DETECTION_FAILED_READS);
+    
+    // The cached profile no longer gets answers (other model, other id)
+    if (sensorData.failedReadCount >= DEMO_DETECTION_FAILED_READS &&
+        profileSource == PROFILE_CACHED && !profileProbePending) {
+      LOG_PRINTF("Cached inverter profile %s gets no answer - probing again\n", activeProfile.name);
+      profileProbePending = true;
+    }
     
     if (DEMO_MODE_ENABLED && sensorData.failedReadCount >= DEMO_DETECTION_FAILED_READS) {
       // Switch to demo mode
@@ -177,71 +802,537 @@ void updateSensorData() {
   // Connection successful - reset counters and disable demo mode
   sensorData.failedReadCount = 0;
   sensorData.demoMode = false;
+  // The cache answers again: a probe still waiting on a retry is not needed
+  if (profileSource == PROFILE_CACHED && profileProbePending) {
+    profileProbePending = false;
+    profileProbe = ProfileProbe();
+  }
   
-  // Charger Stats (15201-15221)
-  sensorData.chargerVoltage = readModbusFloat(15201, 0.1);      // V
-  sensorData.chargerCurrent = readModbusFloat(15202, 0.01);     // A
-  sensorData.chargerPower = readModbusFloat(15203, 1.0);        // W
-  
-  sensorData.pvVoltage = readModbusFloat(15205, 0.1);           // V
-  sensorData.pvCurrent = readModbusFloat(15206, 0.01);          // A
-  sensorData.pvPower = readModbusFloat(15207, 1.0);             // W
+  // Registers the active profile disables are never read
+  for (uint8_t i = first; i < REG_POINT_COUNT; i++) {
+    if (!(activePointMask & REG_BIT(i))) continue;
+    const RegisterPoint &point = activePoints[i];
+    
+    if (point.wide) {
+      // Keep the previous total if either half fails
+      uint16_t high, low;
+      if (readModbusRegister(point.address, &high) && readModbusRegister(point.address + 1, &low)) {
+        sensorData.*point.value = ((uint32_t)high << 16 | low) * point.scale + point.offset;
+      } else if (lastModbusResult == MODBUS_TIMEOUT) {
+        break;
+      }
+      continue;
+    }
+    
+    uint16_t raw = testValue;
+    bool ok = i == first || readModbusRegister(point.address, &raw);
+    if (!ok && lastModbusResult == MODBUS_TIMEOUT) break;
+    if (!point.value) {
+      sensorData.inverterMode = ok ? (int)raw : 0;
+    } else {
+      sensorData.*point.value = ok ? raw * point.scale + point.offset : 0.0;
+    }
+  }
   
-  sensorData.batteryVoltage = readModbusFloat(15213, 0.1);      // V
-  sensorData.batteryCurrent = readModbusFloat(15214, 0.01);     // A
-  sensorData.batteryPower = readModbusFloat(15215, 1.0);        // W
-  sensorData.batterySOC = readModbusFloat(15219, 1.0);          // %
+  // The inverter stopped answering mid-poll: one timeout is enough for this
+  // pass, the registers not reached keep their values until the next poll
+  if (lastModbusResult == MODBUS_TIMEOUT) {
+    LOG_PORT.println(F("Modbus timeout - poll cut short"));
+    sensorData.modbusError = true;
+    return;
+  }
   
-  sensorData.batteryTemp = readModbusFloat(15221, 0.1) - 100.0; // °C
-  sensorData.deviceTemp = readModbusFloat(15220, 0.1) - 100.0;  // °C
+  // Calculate totals
+  sensorData.totalChargerPower = sensorData.chargerAccumulatedPower + sensorData.acChargerAccumulatedPower;
+  sensorData.totalDischargerPower = sensorData.dischargerAccumulatedPower + sensorData.acDischargerAccumulatedPower;
   
-  // Inverter Stats (25201-25274)
-  sensorData.inverterMode = readModbusInt(25201);
-  sensorData.acVoltage = readModbusFloat(25205, 0.1);           // V
-  sensorData.acCurrent = readModbusFloat(25206, 0.01);          // A
-  sensorData.acFrequency = readModbusFloat(25207, 0.01);        // Hz
-  sensorData.acPower = readModbusFloat(25213, 1.0);             // W
-  sensorData.loadPercent = readModbusFloat(25209, 1.0);         // %
+  sensorData.lastUpdate = millis();
+  sensorData.modbusError = false;
   
-  sensorData.dcVoltage = readModbusFloat(25211, 0.1);           // V
-  sensorData.maxChargeCurrent = readModbusFloat(25235, 1.0);    // A
-  sensorData.maxDischargeCurrent = readModbusFloat(25236, 1.0); // A
+  LOG_PORT.println(F("Sensor data updated successfully"));
+}
+
+// ==================== BURST CAPTURE ====================
+// While armed, the burst block is polled back-to-back instead of the full
+// register map; normal polling resumes as soon as the capture completes,
+// is cancelled or times out.
+enum BurstTriggerType {
+  TRIGGER_MANUAL,   // Only POST /api/burst/trigger
+  TRIGGER_ABOVE,
+  TRIGGER_BELOW,
+  TRIGGER_RISE,     // Slope above value (units per second)
+  TRIGGER_FALL      // Slope below -value (units per second)
+};
+
+const char *const burstTriggerNames[] = {"manual", "above", "below", "rise", "fall"};
+const char *const burstStateNames[] = {"idle", "armed", "triggered", "captured"};
+
+// Register, scale and offset come from the active inverter profile and are
+// fixed when the capture is armed; address 0 = not available on this model
+struct BurstChannelConfig {
+  const char *field;
+  uint16_t address;
+  float scale;
+  float offset;
+};
+
+const char *const burstChannelNames[BURST_CHANNEL_COUNT] = BURST_CHANNELS;
+BurstChannelConfig burstChannels[BURST_CHANNEL_COUNT];
+uint8_t burstChannelField[BURST_CHANNEL_COUNT];  // Channel -> sensorFields index
+
+struct BurstTrigger {
+  BurstTriggerType type;
+  uint8_t channel;
+  float value;
+  float lastValue;
+  uint32_t lastUs;
+  bool hasLast;
+};
+
+typedef BurstRing<BURST_CHANNEL_COUNT, BURST_RING_SAMPLES> BurstRingType;
+BurstRingType burstRing;
+BurstTrigger burstTrigger = {TRIGGER_MANUAL, 0, 0, 0, 0, false};
+unsigned long burstArmedAt = 0;
+unsigned long burstTimeoutMs = 0;
+unsigned long burstLastPublish = 0;
+uint32_t burstFailedReads = 0;
+uint8_t burstFailStreak = 0;     // Failed samples in a row
+volatile bool burstCancelPending = false;
+volatile bool burstExportBusy = false;
+
+void resolveBurstChannels() {
+  for (uint8_t c = 0; c < BURST_CHANNEL_COUNT; c++) {
+    BurstChannelConfig &channel = burstChannels[c];
+    channel.field = burstChannelNames[c];
+    channel.address = 0;
+    channel.scale = 1.0;
+    channel.offset = 0;
+    
+    float SensorData::*value = sensorFields[burstChannelField[c]].value;
+    for (uint8_t i = 0; i < REG_POINT_COUNT; i++) {
+      const RegisterPoint &point = activePoints[i];
+      if (point.value == value && !point.wide && (activePointMask & REG_BIT(i))) {
+        channel.address = point.address;
+        channel.scale = point.scale;
+        channel.offset = point.offset;
+      }
+    }
+  }
+}
+
+void initBurstCapture() {
+  for (uint8_t c = 0; c < BURST_CHANNEL_COUNT; c++) {
+    burstChannelField[c] = 0;
+    for (size_t i = 0; i < SENSOR_FIELD_COUNT; i++) {
+      if (fieldMatches(sensorFields[i], burstChannelNames[c], strlen(burstChannelNames[c])) &&
+          sensorFields[i].kind == FIELD_FLOAT) {
+        burstChannelField[c] = i;
+        break;
+      }
+    }
+  }
+  resolveBurstChannels();
+}
+
+bool burstTriggerFires(BurstTrigger &trigger, float value, uint32_t us) {
+  bool fires = false;
+  switch (trigger.type) {
+    case TRIGGER_ABOVE:
+      fires = value > trigger.value;
+      break;
+    case TRIGGER_BELOW:
+      fires = value < trigger.value;
+      break;
+    case TRIGGER_RISE:
+    case TRIGGER_FALL:
+      if (trigger.hasLast && us != trigger.lastUs) {
+        float slope = (value - trigger.lastValue) * 1e6f / (uint32_t)(us - trigger.lastUs);
+        fires = trigger.type == TRIGGER_RISE ? slope > trigger.value : slope < -trigger.value;
+      }
+      break;
+    default:
+      break;
+  }
+  trigger.lastValue = value;
+  trigger.lastUs = us;
+  trigger.hasLast = true;
+  return fires;
+}
+
+void finishBurst() {
+  LOG_PRINTF("Burst capture finished (%s, %u samples) - resuming normal polling\n",
+             burstStateNames[burstRing.state()], burstRing.count());
+  lastModbusUpdate = 0;  // Full poll on the next loop iteration
+}
+
+// One sample of the burst block per loop iteration
+void sampleBurst() {
+  if (burstCancelPending) {
+    burstCancelPending = false;
+    burstRing.cancel();
+    finishBurst();
+    return;
+  }
+  if (burstRing.state() == BurstRingType::ARMED &&
+      millis() - burstArmedAt > burstTimeoutMs) {
+    burstRing.cancel();
+    LOG_PORT.println(F("Burst capture timed out without trigger"));
+    finishBurst();
+    return;
+  }
   
-  // Accumulated Power (requires double register reads for 32-bit values)
-  uint16_t high, low;
+  uint16_t values[BURST_CHANNEL_COUNT];
+  for (uint8_t c = 0; c < BURST_CHANNEL_COUNT; c++) {
+    values[c] = 0;
+    if (!burstChannels[c].address) continue;
+    if (!readModbusRegister(burstChannels[c].address, &values[c])) {
+      burstFailedReads++;
+      // The inverter stopped answering: give the loop back to the regular
+      // poll (and its demo fallback) instead of waiting on it forever
+      if (++burstFailStreak >= BURST_MAX_FAILED_READS) {
+        LOG_PRINTF("Burst capture stopped after %u failed reads in a row\n", burstFailStreak);
+        burstRing.abandon();
+        finishBurst();
+      }
+      return;
+    }
+  }
+  burstFailStreak = 0;
+  uint32_t us = micros();
+  
+  // Keep the live API fed with the channels we do read
+  for (uint8_t c = 0; c < BURST_CHANNEL_COUNT; c++) {
+    const SensorField &field = sensorFields[burstChannelField[c]];
+    if (burstChannels[c].address) {
+      sensorData.*field.value = values[c] * burstChannels[c].scale + burstChannels[c].offset;
+    }
+  }
+  sensorData.lastUpdate = millis();
+  if (millis() - burstLastPublish > MODBUS_UPDATE_INTERVAL) {
+    publishSensorSnapshot();
+    burstLastPublish = millis();
+  }
   
-  // Charger Accumulated Power (kWh) - registers 15231-15232
-  if (readModbusRegister(15231, &high) && readModbusRegister(15232, &low)) {
-    sensorData.chargerAccumulatedPower = ((uint32_t)high << 16 | low) * 0.1;
+  if (burstTrigger.type != TRIGGER_MANUAL) {
+    const BurstChannelConfig &channel = burstChannels[burstTrigger.channel];
+    float value = values[burstTrigger.channel] * channel.scale + channel.offset;
+    if (burstTriggerFires(burstTrigger, value, us)) burstRing.requestTrigger();
   }
   
-  // Discharger Accumulated Power (kWh) - registers 15233-15234
-  if (readModbusRegister(15233, &high) && readModbusRegister(15234, &low)) {
-    sensorData.dischargerAccumulatedPower = ((uint32_t)high << 16 | low) * 0.1;
+  burstRing.push(us, values);
+  if (!burstRing.active()) finishBurst();
+}
+
+// ---- Export: header + one record per sample, streamed from the frozen ring
+struct BurstExportCursor {
+  bool csv;
+  uint16_t next;       // 0 = header, n = sample n - 1
+  char pending[160];   // Current record, possibly only partly sent
+  uint8_t pendingLen;
+  uint8_t pendingPos;
+} burstExport;
+
+const size_t BURST_BIN_HEADER_SIZE = 12 + 10 * BURST_CHANNEL_COUNT;
+const size_t BURST_BIN_RECORD_SIZE = 4 + 2 * BURST_CHANNEL_COUNT;
+
+// Binary layout (little-endian):
+//   header: "MBST", u8 version=1, u8 channels, u16 samples, u16 trigger index,
+//           u16 reserved, then per channel {u16 register (0 = not read),
+//           f32 scale, f32 offset}; value = raw * scale + offset
+//   record: i32 microseconds relative to the trigger, u16 raw value per channel
+size_t formatBurstRecord(uint16_t record, char *out, size_t size) {
+  if (burstExport.csv) {
+    if (record == 0) {
+      size_t len = snprintf(out, size, "t_us");
+      for (uint8_t c = 0; c < BURST_CHANNEL_COUNT; c++) {
+        len += snprintf(out + len, size - len, ",%s", burstChannels[c].field);
+      }
+      len += snprintf(out + len, size - len, "\n");
+      return len;
+    }
+    
+    uint16_t i = record - 1;
+    const uint16_t *values = burstRing.values(i);
+    size_t len = snprintf(out, size, "%ld", (long)burstRing.offsetUs(i));
+    for (uint8_t c = 0; c < BURST_CHANNEL_COUNT; c++) {
+      len += snprintf(out + len, size - len, ",%.*f", sensorFields[burstChannelField[c]].decimals,
+                      values[c] * burstChannels[c].scale + burstChannels[c].offset);
+    }
+    len += snprintf(out + len, size - len, "\n");
+    return len;
   }
   
-  // AC Charger Accumulated Power (kWh) - registers 15235-15236
-  if (readModbusRegister(15235, &high) && readModbusRegister(15236, &low)) {
-    sensorData.acChargerAccumulatedPower = ((uint32_t)high << 16 | low) * 0.1;
+  uint8_t *bytes = (uint8_t *)out;
+  if (record == 0) {
+    uint16_t samples = burstRing.count();
+    uint16_t trigger = burstRing.triggerIndex();
+    uint16_t reserved = 0;
+    memcpy(bytes, "MBST", 4);
+    bytes[4] = 1;
+    bytes[5] = BURST_CHANNEL_COUNT;
+    memcpy(bytes + 6, &samples, 2);
+    memcpy(bytes + 8, &trigger, 2);
+    memcpy(bytes + 10, &reserved, 2);
+    for (uint8_t c = 0; c < BURST_CHANNEL_COUNT; c++) {
+      memcpy(bytes + 12 + 10 * c, &burstChannels[c].address, 2);
+      memcpy(bytes + 14 + 10 * c, &burstChannels[c].scale, 4);
+      memcpy(bytes + 18 + 10 * c, &burstChannels[c].offset, 4);
+    }
+    return BURST_BIN_HEADER_SIZE;
   }
   
-  // AC Discharger Accumulated Power (kWh) - registers 15237-15238
-  if (readModbusRegister(15237, &high) && readModbusRegister(15238, &low)) {
-    sensorData.acDischargerAccumulatedPower = ((uint32_t)high << 16 | low) * 0.1;
+  uint16_t i = record - 1;
+  int32_t offset = burstRing.offsetUs(i);
+  memcpy(bytes, &offset, 4);
+  memcpy(bytes + 4, burstRing.values(i), 2 * BURST_CHANNEL_COUNT);
+  return BURST_BIN_RECORD_SIZE;
+}
+
+size_t fillBurstExport(uint8_t *buffer, size_t maxLen) {
+  size_t written = 0;
+  while (written < maxLen) {
+    if (burstExport.pendingPos == burstExport.pendingLen) {
+      if (burstExport.next > burstRing.count()) break;
+      burstExport.pendingLen = formatBurstRecord(burstExport.next++, burstExport.pending,
+                                                 sizeof(burstExport.pending));
+      burstExport.pendingPos = 0;
+    }
+    size_t chunk = min(maxLen - written, (size_t)(burstExport.pendingLen - burstExport.pendingPos));
+    memcpy(buffer + written, burstExport.pending + burstExport.pendingPos, chunk);
+    written += chunk;
+    burstExport.pendingPos += chunk;
+  }
+  return written;
+}
+
+// ==================== FIRMWARE UPDATE ====================
+// POST /api/update streams the request body into the inactive OTA slot (or
+// the LittleFS partition) as it arrives: the Update library holds one flash
+// sector and feeds every chunk through MD5, and a firmware image only becomes
+// bootable if that matches the hash given by the client (a filesystem image
+// lands on the live partition as it goes; ESP32 only, the ESP8266 keeps its
+// settings there). The loop keeps polling the inverter meanwhile, every
+// OTA_POLL_INTERVAL_MS instead of the regular interval (no burst capture,
+// no profile probe).
+enum UpdateState { UPDATE_IDLE, UPDATE_RECEIVING, UPDATE_SUCCESS, UPDATE_FAILED };
+
+const char *const updateStateNames[] = {"idle", "receiving", "success", "failed"};
+
+#ifdef ESP8266
+const int UPDATE_FS_COMMAND = U_FS;
+#else
+const int UPDATE_FS_COMMAND = U_SPIFFS;  // The LittleFS partition has the spiffs subtype
+#endif
+
+struct UpdateSession {
+  AsyncWebServerRequest *request;  // Transfer this session answers to
+  bool filesystem;
+  int httpCode;                    // Response code once failed
+  const char *error;
+  uint8_t updateError;             // Update.getError() when the library failed
+  size_t size;
+  size_t written;
+  unsigned long startMs;
+  unsigned long endMs;
+  uint32_t flashWriteUs;           // Time spent inside Update.write()
+  // Polls made during the transfer; paused = how long each one was overdue
+  uint32_t polls;
+  unsigned long pollPausedMs;
+  unsigned long pollPausedMaxMs;
+  char md5[33];                    // Computed over the committed image
+};
+
+UpdateSession updateSession = {};
+volatile UpdateState updateState = UPDATE_IDLE;
+
+// ---- Rollback (ESP32): a new image boots in PENDING_VERIFY and only becomes
+// valid once it has read the inverter; if it resets before that, the
+// bootloader goes back to the previous slot. The ESP8266 copies the new image
+// over the old one, so it has nothing to roll back to.
+// Needs app rollback in the core's sdkconfig, checked here at build time;
+// without it every image is final and image_state stays no_rollback.
+#if !defined(ESP8266) && (defined(CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE) || defined(CONFIG_APP_ROLLBACK_ENABLE))
+  #define OTA_ROLLBACK_ENABLED 1
+#else
+  #define OTA_ROLLBACK_ENABLED 0
+#endif
+
+enum ImageState { IMAGE_NO_ROLLBACK, IMAGE_PENDING_VERIFY, IMAGE_VALID };
+
+const char *const imageStateNames[] = {"no_rollback", "pending_verify", "valid"};
+ImageState imageState = IMAGE_NO_ROLLBACK;
+
+#if OTA_ROLLBACK_ENABLED
+// arduino-esp32 would otherwise mark the running image valid during startup
+extern "C" bool verifyRollbackLater() {
+  return true;
+}
+#endif
+
+void initImageState() {
+#if OTA_ROLLBACK_ENABLED
+  esp_ota_img_states_t state;
+  if (esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) != ESP_OK) return;
+  if (state == ESP_OTA_IMG_PENDING_VERIFY) {
+    imageState = IMAGE_PENDING_VERIFY;
+    LOG_PRINTF("New firmware on probation: rolls back unless it polls the inverter within %d s\n",
+               OTA_VERIFY_TIMEOUT_S);
+  } else if (state == ESP_OTA_IMG_VALID) {
+    imageState = IMAGE_VALID;
   }
+#endif
+}
+
+// Called every loop iteration
+void serviceImageVerification() {
+#if OTA_ROLLBACK_ENABLED
+  if (imageState != IMAGE_PENDING_VERIFY) return;
+  if (bootTiming.firstSampleMs) {
+    esp_ota_mark_app_valid_cancel_rollback();
+    imageState = IMAGE_VALID;
+    LOG_PORT.println(F("✓ New firmware polled the inverter - marked valid"));
+  } else if (millis() > OTA_VERIFY_TIMEOUT_S * 1000UL) {
+    LOG_PORT.println(F("✗ New firmware never polled the inverter - rolling back"));
+    esp_ota_mark_app_invalid_rollback_and_reboot();
+  }
+#endif
+}
+
+void failUpdate(int httpCode, const char *error) {
+  if (Update.isRunning()) {
+#ifdef ESP8266
+    Update.end(false);  // Unfinished or failed: discards the image
+#else
+    Update.abort();
+#endif
+  }
+#ifndef ESP8266
+  // beginUpdate() unmounted the partition; what is on it now is part old and
+  // part new image, so it is formatted if it no longer mounts
+  if (updateSession.filesystem && updateState == UPDATE_RECEIVING && !LittleFS.begin(true)) {
+    LOG_PORT.println(F("✗ LittleFS could not be mounted again after the failed update"));
+  }
+#endif
+  updateSession.httpCode = httpCode;
+  updateSession.error = error;
+  updateSession.endMs = millis();
+  updateState = UPDATE_FAILED;
+  LOG_PRINTF("✗ Update failed after %u bytes: %s (error %u)\n",
+             (unsigned)updateSession.written, error, updateSession.updateError);
+}
+
+bool isMd5Text(const String &text) {
+  if (text.length() != 32) return false;
+  for (size_t i = 0; i < 32; i++) {
+    if (!isxdigit(text[i])) return false;
+  }
+  return true;
+}
+
+// The connection of request is gone (aborted or answered): an image still
+// coming in is discarded, and the session stops pointing at the request
+void releaseUpdateRequest(AsyncWebServerRequest *request) {
+  if (updateSession.request != request) return;
+  if (updateState == UPDATE_RECEIVING) failUpdate(400, "Connection closed before the image was complete");
+  updateSession.request = nullptr;
+}
+
+// First chunk of a POST /api/update body. Requests that are not allowed to
+// start a transfer leave the session alone and are answered by
+// handleApiUpdate() once their body is in.
+void beginUpdate(AsyncWebServerRequest *request, size_t total) {
+  if (updateState == UPDATE_RECEIVING || !request->authenticate(currentApiUser, currentApiPass)) return;
+  
+  updateSession = UpdateSession();
+  updateSession.request = request;
+  updateSession.size = total;
+  updateSession.startMs = millis();
+  updateState = UPDATE_IDLE;
+  request->onDisconnect([request]() { releaseUpdateRequest(request); });
+  
+  if (request->hasParam("target")) {
+    const String &target = request->getParam("target")->value();
+    updateSession.filesystem = target == "filesystem";
+    if (!updateSession.filesystem && target != "firmware") {
+      failUpdate(400, "target must be firmware or filesystem");
+      return;
+    }
+  }
+#ifdef ESP8266
+  // The settings (credentials, Wi-Fi, profile) live on that partition
+  if (updateSession.filesystem) {
+    failUpdate(400, "Filesystem updates would erase the settings on ESP8266; use pio run -t uploadfs");
+    return;
+  }
+#endif
+  if (!request->hasParam("md5") || !isMd5Text(request->getParam("md5")->value())) {
+    failUpdate(400, "md5 (32 hex digits) of the image is required");
+    return;
+  }
+  if (total == 0) {
+    failUpdate(411, "Content-Length is required");
+    return;
+  }
+  // Writing now would overwrite the slot the bootloader would roll back to
+  if (imageState == IMAGE_PENDING_VERIFY && !updateSession.filesystem) {
+    failUpdate(409, "Running firmware has not been confirmed yet");
+    return;
+  }
+
+#ifdef ESP8266
+  Update.runAsync(true);  // Called from a TCP callback: no yield() in write()
+#endif
+  if (!Update.begin(total, updateSession.filesystem ? UPDATE_FS_COMMAND : U_FLASH)) {
+    updateSession.updateError = Update.getError();
+    if (updateSession.updateError == UPDATE_ERROR_SPACE || updateSession.updateError == UPDATE_ERROR_SIZE) {
+      failUpdate(413, "Image does not fit the update partition");
+    } else {
+      failUpdate(500, "Update could not start");
+    }
+    return;
+  }
+  Update.setMD5(request->getParam("md5")->value().c_str());
   
-  // Calculate totals
-  sensorData.totalChargerPower = sensorData.chargerAccumulatedPower + sensorData.acChargerAccumulatedPower;
-  sensorData.totalDischargerPower = sensorData.dischargerAccumulatedPower + sensorData.acDischargerAccumulatedPower;
+  // The bus goes back to the regular poll for the whole transfer
+  if (burstRing.active()) burstCancelPending = true;
+  // The image replaces the filesystem under our feet; it comes back mounted
+  // after the restart
+  if (updateSession.filesystem) LittleFS.end();
   
-  sensorData.lastUpdate = millis();
-  sensorData.modbusError = false;
+  updateState = UPDATE_RECEIVING;
+  LOG_PRINTF("Receiving %s image (%u bytes) - telemetry keeps polling\n",
+             updateSession.filesystem ? "filesystem" : "firmware", (unsigned)total);
+}
+
+void finishUpdate() {
+  if (!Update.end()) {
+    updateSession.updateError = Update.getError();
+    if (updateSession.updateError == UPDATE_ERROR_MD5) {
+      failUpdate(400, "Image MD5 does not match");
+    } else {
+      failUpdate(500, "Image could not be committed");
+    }
+    return;
+  }
   
-  Serial.println("Sensor data updated successfully");
+  strlcpy(updateSession.md5, Update.md5String().c_str(), sizeof(updateSession.md5));
+  updateSession.endMs = millis();
+  updateState = UPDATE_SUCCESS;
+  LOG_PRINTF("✓ Update verified: %u bytes in %lu ms, flash writes %lu ms, polling paused %lu ms (max %lu ms)\n",
+             (unsigned)updateSession.written, updateSession.endMs - updateSession.startMs,
+             (unsigned long)(updateSession.flashWriteUs / 1000), updateSession.pollPausedMs,
+             updateSession.pollPausedMaxMs);
+}
+
+// Loop task: a poll made while an image is coming in, overdueMs past its slot
+void recordUpdatePoll(unsigned long overdueMs) {
+  updateSession.polls++;
+  updateSession.pollPausedMs += overdueMs;
+  if (overdueMs > updateSession.pollPausedMaxMs) updateSession.pollPausedMaxMs = overdueMs;
 }
 
 // ==================== API FUNCTIONS ====================
-String getInverterModeText(int mode) {
+const char* getInverterModeText(int mode) {
   switch(mode) {
     case 0: return "Power On";
     case 1: return "Standby";
@@ -254,17 +1345,95 @@ String getInverterModeText(int mode) {
   }
 }
 
+// Restarts asked for by HTTP handlers run from loop(): the response has to
+// go out first, and the ESP8266 cannot delay() inside a TCP callback
+bool restartPending = false;
+bool restartResetsWifi = false;
+unsigned long restartAt = 0;
+
+void scheduleRestart(unsigned long delayMs, bool resetWifi) {
+  restartAt = millis() + delayMs;
+  restartResetsWifi = resetWifi;
+  restartPending = true;
+}
+
+void serviceRestart() {
+  if (!restartPending || (long)(millis() - restartAt) < 0) return;
+  if (restartResetsWifi) wifiManager.resetSettings();
+  ESP.restart();
+}
+
 bool checkAuthentication(AsyncWebServerRequest *request) {
-  if (!request->authenticate(currentApiUser.c_str(), currentApiPass.c_str())) {
+  if (!request->authenticate(currentApiUser, currentApiPass)) {
     request->requestAuthentication();
     return false;
   }
   return true;
 }
 
+// ==================== RESPONSE HELPERS ====================
+// Count the hit and hand the route a clean arena for its JsonDocument
+void beginRoute(RouteId route) {
+  routeStats[route].requests++;
+  jsonArena.reset();
+}
+
+// Fixed bodies are sent straight from flash, no String copy (pass them
+// through PSTR so the ESP8266 keeps them there too)
+void sendStaticJson(AsyncWebServerRequest *request, int code, PGM_P body) {
+  request->send_P(code, "application/json", body);
+}
+
+// Serialize doc into a pooled buffer and let AsyncWebServer stream it from
+// there. The slot returns to the pool when the client disconnects; a request
+// holds one disconnect handler, so a route that needs its own passes it as
+// onDone.
+template <typename Pool>
+void sendJsonFrom(Pool &pool, size_t arenaUsed, AsyncWebServerRequest *request, RouteId route, JsonDocument &doc, bool pretty,
+                  int code = 200, std::function<void()> onDone = nullptr) {
+  RouteStats &stats = routeStats[route];
+  if (arenaUsed > stats.arenaPeak) stats.arenaPeak = arenaUsed;
+  
+  size_t length = pretty ? measureJsonPretty(doc) : measureJson(doc);
+  if (doc.overflowed() || length >= pool.slotSize()) {
+    stats.failures++;
+    LOG_PRINTF("✗ %s: response does not fit static buffers (%u bytes)\n", stats.path, (unsigned)length);
+    sendStaticJson(request, 500, PSTR("{\"error\":\"Response too large\"}"));
+    return;
+  }
+  
+  auto *slot = pool.acquire();
+  if (!slot) {
+    stats.failures++;
+    sendStaticJson(request, 503, PSTR("{\"error\":\"Server busy\"}"));
+    return;
+  }
+  
+  if (pretty) {
+    serializeJsonPretty(doc, slot->data, pool.slotSize());
+  } else {
+    serializeJson(doc, slot->data, pool.slotSize());
+  }
+  if (length > stats.responsePeak) stats.responsePeak = length;
+  
+  request->onDisconnect([&pool, slot, onDone]() {
+    pool.release(slot);
+    if (onDone) onDone();
+  });
+  request->send(request->beginResponse_P(code, "application/json", (const uint8_t *)slot->data, length));
+}
+
+void sendJson(AsyncWebServerRequest *request, RouteId route, JsonDocument &doc, bool pretty = false, int code = 200,
+              std::function<void()> onDone = nullptr) {
+  sendJsonFrom(responsePool, jsonArena.used(), request, route, doc, pretty, code, onDone);
+}
+
 void handleRoot(AsyncWebServerRequest *request) {
+  PROFILE_ROUTE(ROUTE_ROOT);
+  routeStats[ROUTE_ROOT].requests++;
+  
   // Check if WiFi is connected (not in AP mode)
-  bool isConfigured = WiFi.status() == WL_CONNECTED && String(WiFi.SSID()) != String(AP_SSID);
+  bool isConfigured = WiFi.status() == WL_CONNECTED && strcmp(connectedSSID, AP_SSID) != 0;
   
   if (!isConfigured) {
     // Serve configuration page when not connected (no auth needed)
@@ -274,95 +1443,274 @@ void handleRoot(AsyncWebServerRequest *request) {
     if (!checkAuthentication(request)) return;
     request->send(LittleFS, "/index.html", "text/html");
   }
-}
-
-void handleApiSensors(AsyncWebServerRequest *request) {
-  if (!checkAuthentication(request)) return;
+}
+
+void handleApiSensors(AsyncWebServerRequest *request) {
+  PROFILE_ROUTE(ROUTE_SENSORS);
+  if (!checkAuthentication(request)) return;
+  beginRoute(ROUTE_SENSORS);
+  
+  // Optional projection (?fields=battery.soc,pv) and delta (?since=<seq>)
+  uint32_t selected = ALL_SENSOR_FIELDS;
+  bool filtered = false;
+  for (size_t i = 0; i < request->params(); i++) {
+    AsyncWebParameter *param = request->getParam(i);
+    if (param->isPost() || param->isFile()) continue;
+    
+    if (param->name() == "fields") {
+      uint32_t fields;
+      if (!parseFieldSelection(param->value().c_str(), &fields)) {
+        sendStaticJson(request, 400, PSTR("{\"error\":\"Unknown field in fields parameter\"}"));
+        return;
+      }
+      selected &= fields;
+      filtered = true;
+    } else if (param->name() == "since") {
+      uint64_t since = strtoull(param->value().c_str(), NULL, 10);
+      // A sequence from another boot (or ahead of ours) says nothing about
+      // what the client has: send everything
+      if ((since >> 32) == snapshotBootId && (uint32_t)since <= snapshotSeq) {
+        for (size_t f = 0; f < SENSOR_FIELD_COUNT; f++) {
+          if (fieldChangeSeq[f] <= (uint32_t)since) selected &= ~(1u << f);
+        }
+      }
+      filtered = true;
+    }
+  }
+  
+  if (selected == 0) {
+    request->send(304);
+    return;
+  }
   
   // Create JSON document
-  JsonDocument doc;
-  
-  // Charger section
-  JsonObject charger = doc["charger"].to<JsonObject>();
-  charger["voltage"] = round(sensorData.chargerVoltage * 10) / 10.0;
-  charger["current"] = round(sensorData.chargerCurrent * 100) / 100.0;
-  charger["power"] = round(sensorData.chargerPower);
-  charger["accumulated_power"] = round(sensorData.chargerAccumulatedPower * 10) / 10.0;
-  
-  // PV section
-  JsonObject pv = doc["pv"].to<JsonObject>();
-  pv["voltage"] = round(sensorData.pvVoltage * 10) / 10.0;
-  pv["current"] = round(sensorData.pvCurrent * 100) / 100.0;
-  pv["power"] = round(sensorData.pvPower);
-  
-  // Battery section
-  JsonObject battery = doc["battery"].to<JsonObject>();
-  battery["voltage"] = round(sensorData.batteryVoltage * 10) / 10.0;
-  battery["current"] = round(sensorData.batteryCurrent * 100) / 100.0;
-  battery["power"] = round(sensorData.batteryPower);
-  battery["soc"] = round(sensorData.batterySOC);
-  battery["temperature"] = round(sensorData.batteryTemp * 10) / 10.0;
-  
-  // Inverter section
-  JsonObject inverter = doc["inverter"].to<JsonObject>();
-  inverter["mode"] = getInverterModeText(sensorData.inverterMode);
-  inverter["mode_id"] = sensorData.inverterMode;
-  inverter["ac_voltage"] = round(sensorData.acVoltage * 10) / 10.0;
-  inverter["ac_current"] = round(sensorData.acCurrent * 100) / 100.0;
-  inverter["ac_frequency"] = round(sensorData.acFrequency * 100) / 100.0;
-  inverter["ac_power"] = round(sensorData.acPower);
-  inverter["load_percent"] = round(sensorData.loadPercent);
-  inverter["dc_voltage"] = round(sensorData.dcVoltage * 10) / 10.0;
-  inverter["max_charge_current"] = round(sensorData.maxChargeCurrent);
-  inverter["max_discharge_current"] = round(sensorData.maxDischargeCurrent);
-  inverter["accumulated_power"] = round(sensorData.acDischargerAccumulatedPower * 10) / 10.0;
-  
-  // Totals section
-  JsonObject totals = doc["totals"].to<JsonObject>();
-  totals["total_charged"] = round(sensorData.totalChargerPower * 10) / 10.0;
-  totals["total_discharged"] = round(sensorData.totalDischargerPower * 10) / 10.0;
-  totals["device_temperature"] = round(sensorData.deviceTemp * 10) / 10.0;
+  JsonDocument doc(&jsonArena);
+  
+  const char *currentSection = nullptr;
+  JsonObject section;
+  for (size_t i = 0; i < SENSOR_FIELD_COUNT; i++) {
+    if (!(selected & (1u << i))) continue;
+    
+    const SensorField &field = sensorFields[i];
+    if (field.section != currentSection) {
+      section = doc[field.section].to<JsonObject>();
+      currentSection = field.section;
+    }
+    
+    if (field.kind == FIELD_MODE_TEXT) {
+      section[field.key] = getInverterModeText((int)publishedValues[i]);
+    } else if (field.kind == FIELD_MODE_ID) {
+      section[field.key] = (int)publishedValues[i];
+    } else {
+      section[field.key] = publishedValues[i];
+    }
+  }
   
   // Metadata
+  doc["seq"] = publishedSeq();
   doc["last_update"] = sensorData.lastUpdate;
   doc["uptime"] = millis() / 1000;
   doc["modbus_error"] = sensorData.modbusError;
   doc["demo_mode"] = sensorData.demoMode;
   
-  String response;
-  serializeJsonPretty(doc, response);
+  // Full document stays pretty-printed; filtered queries are for collectors
+  sendJson(request, ROUTE_SENSORS, doc, !filtered);
+}
+
+void handleApiStats(AsyncWebServerRequest *request) {
+  PROFILE_ROUTE(ROUTE_STATS);
+  if (!checkAuthentication(request)) return;
+  routeStats[ROUTE_STATS].requests++;
+  
+  // Same ?fields= syntax as /api/sensors; ?window=<seconds> picks one window
+  uint32_t selected = ALL_SENSOR_FIELDS;
+  uint8_t firstWindow = 0;
+  uint8_t lastWindow = STATS_WINDOW_COUNT - 1;
+  for (size_t i = 0; i < request->params(); i++) {
+    AsyncWebParameter *param = request->getParam(i);
+    if (param->isPost() || param->isFile()) continue;
+    
+    if (param->name() == "fields") {
+      if (!parseFieldSelection(param->value().c_str(), &selected)) {
+        sendStaticJson(request, 400, PSTR("{\"error\":\"Unknown field in fields parameter\"}"));
+        return;
+      }
+    } else if (param->name() == "window") {
+      uint32_t seconds = strtoul(param->value().c_str(), NULL, 10);
+      uint8_t w = 0;
+      while (w < STATS_WINDOW_COUNT && statsWindowSeconds[w] != seconds) w++;
+      if (w == STATS_WINDOW_COUNT) {
+        sendStaticJson(request, 400, PSTR("{\"error\":\"Unknown window\"}"));
+        return;
+      }
+      firstWindow = lastWindow = w;
+    }
+  }
+  
+  largeArena.reset();
+  JsonDocument doc(&largeArena);
+  
+  JsonArray windows = doc["window_s"].to<JsonArray>();
+  for (uint8_t w = firstWindow; w <= lastWindow; w++) {
+    windows.add(statsWindowSeconds[w]);
+  }
+  doc["slots_per_window"] = STATS_SLOTS_PER_WINDOW;
+  // Nothing is fed while the inverter does not answer, in demo mode or
+  // during a burst capture (and less often while an image comes in); the
+  // windows drain meanwhile
+  unsigned long now = millis();
+  if (statsLastSampleMs) {
+    doc["sample_age_ms"] = now - statsLastSampleMs;
+  } else {
+    doc["sample_age_ms"] = nullptr;
+  }
+  
+  // One entry per window, in window_s order: n, mean, stddev, min, max
+  JsonObject fields = doc["fields"].to<JsonObject>();
+  for (size_t row = 0; row < STATS_FIELD_COUNT; row++) {
+    uint8_t index = statsFieldIndex[row];
+    if (!(selected & (1u << index))) continue;
+    
+    char name[40];
+    snprintf(name, sizeof(name), "%s.%s", sensorFields[index].section, sensorFields[index].key);
+    JsonArray perWindow = fields[name].to<JsonArray>();
+    
+    for (uint8_t w = firstWindow; w <= lastWindow; w++) {
+      RollingWindow<STATS_SLOTS_PER_WINDOW>::Snapshot window = rollingStats[row][w].snapshot(now);
+      JsonObject stats = perWindow.add<JsonObject>();
+      stats["n"] = window.count;
+      if (window.count == 0) continue;
+      stats["mean"] = (float)window.mean;
+      stats["stddev"] = (float)window.stddev;
+      stats["min"] = window.min;
+      stats["max"] = window.max;
+    }
+  }
   
-  request->send(200, "application/json", response);
+  sendJsonFrom(largeResponsePool, largeArena.used(), request, ROUTE_STATS, doc, false);
 }
 
 void handleApiStatus(AsyncWebServerRequest *request) {
-  JsonDocument doc;
+  PROFILE_ROUTE(ROUTE_STATUS);
+  beginRoute(ROUTE_STATUS);
+  JsonDocument doc(&jsonArena);
+  
+  IPAddress ip = WiFi.localIP();
+  char ipText[16];
+  snprintf(ipText, sizeof(ipText), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  char macText[18];
+  snprintf(macText, sizeof(macText), "%02X:%02X:%02X:%02X:%02X:%02X",
+           mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
   
   doc["device_name"] = DEVICE_NAME;
-  doc["ip_address"] = WiFi.localIP().toString();
-  doc["mac_address"] = WiFi.macAddress();
-  doc["wifi_ssid"] = WiFi.SSID();
+  doc["firmware_version"] = FIRMWARE_VERSION;
+  doc["ip_address"] = ipText;
+  doc["mac_address"] = macText;
+  doc["wifi_ssid"] = connectedSSID;
   doc["wifi_rssi"] = WiFi.RSSI();
   doc["uptime_seconds"] = millis() / 1000;
   doc["free_heap"] = ESP.getFreeHeap();
+#ifdef ESP8266
+  doc["largest_free_block"] = ESP.getMaxFreeBlockSize();
+  doc["heap_fragmentation"] = ESP.getHeapFragmentation();
+#else
+  doc["min_free_heap"] = ESP.getMinFreeHeap();
+  doc["largest_free_block"] = ESP.getMaxAllocHeap();
+#endif
   doc["modbus_connected"] = !sensorData.modbusError;
   
-  String response;
-  serializeJsonPretty(doc, response);
+  JsonObject profile = doc["inverter_profile"].to<JsonObject>();
+  char signatureText[9];
+  snprintf(signatureText, sizeof(signatureText), "%08X", profileSignature);
+  profile["name"] = activeProfile.name;
+  profile["source"] = profileSourceNames[profileSource];
+  profile["signature"] = signatureText;
+  JsonArray disabled = profile["disabled_fields"].to<JsonArray>();
+  for (size_t i = 0; i < SENSOR_FIELD_COUNT; i++) {
+    const SensorField &field = sensorFields[i];
+    for (uint8_t p = 0; p < REG_POINT_COUNT; p++) {
+      if (activePoints[p].value == field.value && !(activePointMask & REG_BIT(p))) {
+        char name[48];
+        snprintf(name, sizeof(name), "%s.%s", field.section, field.key);
+        disabled.add(name);
+      }
+    }
+  }
+  
+  // Boot milestones in ms since power-on; null until reached
+  JsonObject boot = doc["boot"].to<JsonObject>();
+  const unsigned long milestones[] = {bootTiming.modbusReadyMs, bootTiming.firstPollMs, bootTiming.firstSampleMs,
+                                      bootTiming.wifiConnectedMs, bootTiming.httpReadyMs};
+  const char *const milestoneNames[] = {"modbus_ready_ms", "first_poll_ms", "first_sample_ms",
+                                        "wifi_connected_ms", "http_ready_ms"};
+  for (uint8_t i = 0; i < sizeof(milestones) / sizeof(milestones[0]); i++) {
+    if (milestones[i]) {
+      boot[milestoneNames[i]] = milestones[i];
+    } else {
+      boot[milestoneNames[i]] = nullptr;
+    }
+  }
+  
+  JsonObject poll = doc["modbus_poll"].to<JsonObject>();
+  poll["last_ms"] = sensorData.pollDurationMs;
+  poll["max_ms"] = sensorData.pollDurationMaxMs;
+  poll["interval_ms"] = sensorData.pollIntervalMs;
+  
+  // RTU master: per-result counters and request-to-response latency
+  const ModbusBusStats &busStats = modbus.stats();
+  JsonObject bus = doc["modbus_bus"].to<JsonObject>();
+  bus["transactions"] = busStats.transactions;
+  bus["last_latency_us"] = busStats.lastLatencyUs;
+  bus["max_latency_us"] = busStats.maxLatencyUs;
+  bus["last_exception"] = busStats.lastException;
+  JsonObject results = bus["results"].to<JsonObject>();
+  for (int i = 0; i < MODBUS_RESULT_COUNT; i++) {
+    results[ModbusRtuMaster::resultName((ModbusResult)i)] = busStats.results[i];
+  }
+  
+  // Static request path buffers
+  JsonObject memory = doc["memory"].to<JsonObject>();
+  JsonObject arena = memory["json_arena"].to<JsonObject>();
+  arena["size"] = jsonArena.capacity();
+  arena["peak"] = jsonArena.peak();
+  arena["failures"] = jsonArena.failures();
+  JsonObject pool = memory["response_pool"].to<JsonObject>();
+  pool["slots"] = responsePool.slotCount();
+  pool["slot_size"] = responsePool.slotSize();
+  pool["in_use"] = responsePool.inUse();
+  pool["peak_in_use"] = responsePool.peakInUse();
+  pool["exhausted"] = responsePool.exhausted();
+  
+  JsonArray routes = doc["routes"].to<JsonArray>();
+  for (int i = 0; i < ROUTE_COUNT; i++) {
+    JsonObject route = routes.add<JsonObject>();
+    route["path"] = routeStats[i].path;
+    route["requests"] = routeStats[i].requests;
+    route["arena_peak"] = routeStats[i].arenaPeak;
+    route["response_peak"] = routeStats[i].responsePeak;
+    route["failures"] = routeStats[i].failures;
+  }
   
-  request->send(200, "application/json", response);
+  // Pretty-printed, except in the lean build where it has to fit a smaller slot
+  sendJson(request, ROUTE_STATUS, doc, !LEAN_PROFILE);
 }
 
 void handleApiCredentials(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+  PROFILE_ROUTE(ROUTE_CREDENTIALS_POST);
+  
   // Verificar autenticação
   if (!checkAuthentication(request)) return;
   
   // Parse JSON body
-  JsonDocument doc;
+  beginRoute(ROUTE_CREDENTIALS_POST);
+  JsonDocument doc(&jsonArena);
   DeserializationError error = deserializeJson(doc, data, len);
   
   if (error) {
-    request->send(400, "application/json", "{\"error\":\"Invalid JSON\"}");
+    sendStaticJson(request, 400, PSTR("{\"error\":\"Invalid JSON\"}"));
     return;
   }
   
@@ -374,88 +1722,444 @@ void handleApiCredentials(AsyncWebServerRequest *request, uint8_t *data, size_t
   const char* wifiPassword = doc["wifi_password"] | "";
   
   // Validar senha atual
-  if (String(currentPassword) != currentApiPass) {
-    request->send(401, "application/json", "{\"error\":\"Current password is incorrect\"}");
-    Serial.println("❌ Credential change failed: incorrect current password");
+  if (strcmp(currentPassword, currentApiPass) != 0) {
+    sendStaticJson(request, 401, PSTR("{\"error\":\"Current password is incorrect\"}"));
+    LOG_PORT.println(F("❌ Credential change failed: incorrect current password"));
     return;
   }
   
   // Validar se há algo para alterar
   if (strlen(newUsername) == 0 && strlen(newPassword) == 0 && strlen(wifiSSID) == 0) {
-    request->send(400, "application/json", "{\"error\":\"No changes provided\"}");
+    sendStaticJson(request, 400, PSTR("{\"error\":\"No changes provided\"}"));
     return;
   }
   
   // Validar tamanho da senha API
   if (strlen(newPassword) > 0 && strlen(newPassword) < 6) {
-    request->send(400, "application/json", "{\"error\":\"Password must be at least 6 characters\"}");
+    sendStaticJson(request, 400, PSTR("{\"error\":\"Password must be at least 6 characters\"}"));
+    return;
+  }
+  
+  // Credenciais ficam em buffers fixos
+  if (strlen(newUsername) >= CREDENTIAL_MAX_LEN || strlen(newPassword) >= CREDENTIAL_MAX_LEN) {
+    sendStaticJson(request, 400, PSTR("{\"error\":\"Username and password must be at most 40 characters\"}"));
     return;
   }
   
   // Validar WiFi
   if (strlen(wifiSSID) > 0 && strlen(wifiPassword) == 0) {
-    request->send(400, "application/json", "{\"error\":\"WiFi password is required when SSID is provided\"}");
+    sendStaticJson(request, 400, PSTR("{\"error\":\"WiFi password is required when SSID is provided\"}"));
     return;
   }
   
   if (strlen(wifiPassword) > 0 && strlen(wifiPassword) < 8) {
-    request->send(400, "application/json", "{\"error\":\"WiFi password must be at least 8 characters\"}");
+    sendStaticJson(request, 400, PSTR("{\"error\":\"WiFi password must be at least 8 characters\"}"));
     return;
   }
   
-  // Atualizar credenciais
-  String finalUsername = strlen(newUsername) > 0 ? String(newUsername) : currentApiUser;
-  String finalPassword = strlen(newPassword) > 0 ? String(newPassword) : currentApiPass;
+  // Atualizar credenciais (temporário até o restart)
+  if (strlen(newUsername) > 0) strlcpy(currentApiUser, newUsername, sizeof(currentApiUser));
+  if (strlen(newPassword) > 0) strlcpy(currentApiPass, newPassword, sizeof(currentApiPass));
   
   // Salvar credenciais API no Preferences
   prefs.begin("credentials", false);
-  prefs.putString("api_user", finalUsername);
-  prefs.putString("api_pass", finalPassword);
+  prefs.putString("api_user", currentApiUser);
+  prefs.putString("api_pass", currentApiPass);
   prefs.end();
   
   // Salvar WiFi no Preferences se fornecido
   bool wifiChanged = false;
   if (strlen(wifiSSID) > 0) {
     prefs.begin("wifi", false);
-    prefs.putString("ssid", String(wifiSSID));
-    prefs.putString("password", String(wifiPassword));
+    prefs.putString("ssid", wifiSSID);
+    prefs.putString("password", wifiPassword);
     prefs.end();
     wifiChanged = true;
     
-    Serial.println("✅ WiFi configuration updated:");
-    Serial.printf("   SSID: %s\n", wifiSSID);
-    Serial.println("   Password: ***");
+    LOG_PORT.println(F("✅ WiFi configuration updated:"));
+    LOG_PRINTF("   SSID: %s\n", wifiSSID);
+    LOG_PORT.println(F("   Password: ***"));
   }
   
-  // Atualizar variáveis globais (temporário até o restart)
-  currentApiUser = finalUsername;
-  currentApiPass = finalPassword;
-  
-  Serial.println("✅ API credentials updated successfully:");
-  Serial.printf("   Username: %s\n", finalUsername.c_str());
-  Serial.println("   Password: ***");
+  LOG_PORT.println(F("✅ API credentials updated successfully:"));
+  LOG_PRINTF("   Username: %s\n", currentApiUser);
+  LOG_PORT.println(F("   Password: ***"));
   
   if (wifiChanged) {
-    Serial.println("🔄 Device will restart in 2 seconds to apply WiFi changes...");
+    LOG_PORT.println(F("🔄 Device will restart in 2 seconds to apply WiFi changes..."));
   } else {
-    Serial.println("🔄 Device will restart in 2 seconds to apply credential changes...");
+    LOG_PORT.println(F("🔄 Device will restart in 2 seconds to apply credential changes..."));
   }
   
   // Responder com sucesso
-  JsonDocument responseDoc;
+  JsonDocument responseDoc(&jsonArena);
   responseDoc["success"] = true;
   responseDoc["message"] = "Credentials updated successfully. Device will restart in 2 seconds.";
-  responseDoc["username"] = finalUsername;
+  responseDoc["username"] = currentApiUser;
   responseDoc["note"] = "ESP32 will restart to load new credentials from EEPROM";
   
-  String response;
-  serializeJson(responseDoc, response);
+  sendJson(request, ROUTE_CREDENTIALS_POST, responseDoc);
+  
+  // Reiniciar após 2 segundos
+  scheduleRestart(2000, false);
+}
+
+// ==================== BURST CAPTURE API ====================
+void handleApiBurst(AsyncWebServerRequest *request) {
+  PROFILE_ROUTE(ROUTE_BURST);
+  if (!checkAuthentication(request)) return;
   
-  request->send(200, "application/json", response);
+  beginRoute(ROUTE_BURST);
+  JsonDocument doc(&jsonArena);
+  BurstRingType::State state = burstRing.state();
+  
+  doc["state"] = burstStateNames[state];
+  doc["capacity"] = burstRing.capacity();
+  doc["samples"] = burstRing.count();
+  doc["pre_samples"] = burstRing.preSamples();
+  doc["failed_reads"] = burstFailedReads;
+  if (burstRing.active()) doc["armed_ms"] = millis() - burstArmedAt;
+  
+  JsonArray channels = doc["channels"].to<JsonArray>();
+  for (uint8_t c = 0; c < BURST_CHANNEL_COUNT; c++) {
+    JsonObject channel = channels.add<JsonObject>();
+    channel["field"] = burstChannels[c].field;
+    channel["register"] = burstChannels[c].address;
+    channel["scale"] = burstChannels[c].scale;
+    channel["offset"] = burstChannels[c].offset;
+  }
   
-  // Reiniciar ESP32 após 2 segundos
-  delay(2000);
-  ESP.restart();
+  JsonObject trigger = doc["trigger"].to<JsonObject>();
+  trigger["type"] = burstTriggerNames[burstTrigger.type];
+  if (burstTrigger.type != TRIGGER_MANUAL) {
+    trigger["field"] = burstChannels[burstTrigger.channel].field;
+    trigger["value"] = burstTrigger.value;
+  }
+  
+  if (state == BurstRingType::CAPTURED && burstRing.count() > 1) {
+    uint32_t spanUs = burstRing.timeUs(burstRing.count() - 1) - burstRing.timeUs(0);
+    doc["trigger_index"] = burstRing.triggerIndex();
+    doc["duration_us"] = spanUs;
+    doc["sample_rate_hz"] = spanUs ? (burstRing.count() - 1) * 1e6 / spanUs : 0;
+  }
+  
+  sendJson(request, ROUTE_BURST, doc);
+}
+
+// Body: {"trigger": {"field": "inverter.ac_power", "type": "above", "value": 1500},
+//        "pre_samples": 128, "timeout_s": 600}
+// Without "trigger" the capture only fires on POST /api/burst/trigger.
+void handleApiBurstArm(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+  PROFILE_ROUTE(ROUTE_BURST_ARM);
+  if (!checkAuthentication(request)) return;
+  
+  beginRoute(ROUTE_BURST_ARM);
+  if (sensorData.demoMode) {
+    sendStaticJson(request, 409, PSTR("{\"error\":\"Burst capture needs a connected inverter\"}"));
+    return;
+  }
+  if (burstRing.active() || burstExportBusy) {
+    sendStaticJson(request, 409, PSTR("{\"error\":\"Burst capture already running or being downloaded\"}"));
+    return;
+  }
+  if (updateState == UPDATE_RECEIVING) {
+    sendStaticJson(request, 409, PSTR("{\"error\":\"Firmware update in progress\"}"));
+    return;
+  }
+  
+  JsonDocument doc(&jsonArena);
+  if (len > 0 && deserializeJson(doc, data, len)) {
+    sendStaticJson(request, 400, PSTR("{\"error\":\"Invalid JSON\"}"));
+    return;
+  }
+  
+  BurstTrigger trigger = {TRIGGER_MANUAL, 0, 0, 0, 0, false};
+  JsonObject triggerJson = doc["trigger"];
+  if (!triggerJson.isNull()) {
+    const char *type = triggerJson["type"] | "";
+    bool knownType = false;
+    for (uint8_t t = TRIGGER_ABOVE; t <= TRIGGER_FALL; t++) {
+      if (strcmp(type, burstTriggerNames[t]) == 0) {
+        trigger.type = (BurstTriggerType)t;
+        knownType = true;
+      }
+    }
+    if (!knownType) {
+      sendStaticJson(request, 400, PSTR("{\"error\":\"Trigger type must be above, below, rise or fall\"}"));
+      return;
+    }
+    
+    const char *field = triggerJson["field"] | "";
+    bool knownField = false;
+    for (uint8_t c = 0; c < BURST_CHANNEL_COUNT; c++) {
+      if (strcmp(field, burstChannelNames[c]) == 0) {
+        trigger.channel = c;
+        knownField = true;
+      }
+    }
+    if (!knownField) {
+      sendStaticJson(request, 400, PSTR("{\"error\":\"Trigger field must be one of the burst channels\"}"));
+      return;
+    }
+    
+    if (!triggerJson["value"].is<float>()) {
+      sendStaticJson(request, 400, PSTR("{\"error\":\"Trigger value is required\"}"));
+      return;
+    }
+    trigger.value = triggerJson["value"];
+  }
+  
+  uint16_t preSamples = doc["pre_samples"] | BURST_DEFAULT_PRE_SAMPLES;
+  uint32_t timeoutS = doc["timeout_s"] | BURST_ARM_TIMEOUT_S;
+  if (preSamples >= BURST_RING_SAMPLES || timeoutS == 0) {
+    sendStaticJson(request, 400, PSTR("{\"error\":\"pre_samples must be below the ring capacity and timeout_s above 0\"}"));
+    return;
+  }
+  
+  resolveBurstChannels();
+  if (trigger.type != TRIGGER_MANUAL && !burstChannels[trigger.channel].address) {
+    sendStaticJson(request, 400, PSTR("{\"error\":\"Trigger field is not available on this inverter model\"}"));
+    return;
+  }
+  
+  burstTrigger = trigger;
+  burstFailedReads = 0;
+  burstFailStreak = 0;
+  burstArmedAt = millis();
+  burstTimeoutMs = timeoutS * 1000;
+  // A cancel that raced the previous capture finishing on its own is never
+  // consumed by sampleBurst(); it must not hit this one
+  burstCancelPending = false;
+  burstRing.arm(preSamples);  // Last: the loop task starts sampling from here
+  
+  LOG_PRINTF("Burst capture armed (%s trigger, %u pre-trigger samples)\n",
+             burstTriggerNames[trigger.type], preSamples);
+  sendStaticJson(request, 200, PSTR("{\"success\":true,\"state\":\"armed\"}"));
+}
+
+void handleApiBurstTrigger(AsyncWebServerRequest *request) {
+  PROFILE_ROUTE(ROUTE_BURST_TRIGGER);
+  if (!checkAuthentication(request)) return;
+  
+  routeStats[ROUTE_BURST_TRIGGER].requests++;
+  if (burstRing.state() != BurstRingType::ARMED) {
+    sendStaticJson(request, 409, PSTR("{\"error\":\"Burst capture is not armed\"}"));
+    return;
+  }
+  burstRing.requestTrigger();
+  sendStaticJson(request, 200, PSTR("{\"success\":true,\"state\":\"triggered\"}"));
+}
+
+void handleApiBurstCancel(AsyncWebServerRequest *request) {
+  PROFILE_ROUTE(ROUTE_BURST_CANCEL);
+  if (!checkAuthentication(request)) return;
+  
+  routeStats[ROUTE_BURST_CANCEL].requests++;
+  if (burstExportBusy) {
+    sendStaticJson(request, 409, PSTR("{\"error\":\"Burst capture is being downloaded\"}"));
+    return;
+  }
+  if (burstRing.active()) {
+    burstCancelPending = true;  // The loop task owns the ring while sampling
+  } else {
+    burstRing.cancel();
+  }
+  sendStaticJson(request, 200, PSTR("{\"success\":true,\"state\":\"idle\"}"));
+}
+
+// ?format=csv (default) or ?format=bin; only once the capture is complete
+void handleApiBurstData(AsyncWebServerRequest *request) {
+  PROFILE_ROUTE(ROUTE_BURST_DATA);
+  if (!checkAuthentication(request)) return;
+  
+  routeStats[ROUTE_BURST_DATA].requests++;
+  if (burstRing.state() != BurstRingType::CAPTURED) {
+    sendStaticJson(request, 409, PSTR("{\"error\":\"No completed burst capture\"}"));
+    return;
+  }
+  if (burstExportBusy) {
+    sendStaticJson(request, 503, PSTR("{\"error\":\"Server busy\"}"));
+    return;
+  }
+  
+  bool csv = true;
+  if (request->hasParam("format")) {
+    const String &format = request->getParam("format")->value();
+    if (format == "bin") {
+      csv = false;
+    } else if (format != "csv") {
+      sendStaticJson(request, 400, PSTR("{\"error\":\"format must be csv or bin\"}"));
+      return;
+    }
+  }
+  
+  burstExportBusy = true;
+  burstExport.csv = csv;
+  burstExport.next = 0;
+  burstExport.pendingLen = 0;
+  burstExport.pendingPos = 0;
+  
+  AwsResponseFiller filler = [](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+    return fillBurstExport(buffer, maxLen);
+  };
+  AsyncWebServerResponse *response;
+  if (csv) {
+    response = request->beginChunkedResponse("text/csv", filler);
+    response->addHeader("Content-Disposition", "attachment; filename=\"burst.csv\"");
+  } else {
+    size_t length = BURST_BIN_HEADER_SIZE + (size_t)burstRing.count() * BURST_BIN_RECORD_SIZE;
+    response = request->beginResponse("application/octet-stream", length, filler);
+    response->addHeader("Content-Disposition", "attachment; filename=\"burst.bin\"");
+  }
+  request->onDisconnect([]() { burstExportBusy = false; });
+  request->send(response);
+}
+
+// ==================== FIRMWARE UPDATE API ====================
+void addUpdateReport(JsonObject report) {
+  const UpdateSession &session = updateSession;
+  UpdateState state = updateState;
+  unsigned long elapsed = (state == UPDATE_RECEIVING ? millis() : session.endMs) - session.startMs;
+  
+  report["state"] = updateStateNames[state];
+  report["target"] = session.filesystem ? "filesystem" : "firmware";
+  report["size"] = session.size;
+  report["written"] = session.written;
+  if (state == UPDATE_FAILED) {
+    report["error"] = session.error;
+    report["update_error"] = session.updateError;
+  }
+  if (session.md5[0]) report["md5"] = session.md5;
+  report["duration_ms"] = elapsed;
+  report["throughput_bytes_s"] = elapsed ? (uint32_t)((uint64_t)session.written * 1000 / elapsed) : 0;
+  report["flash_write_ms"] = session.flashWriteUs / 1000;
+  
+  // Telemetry during the transfer: paused = time the polls ran late
+  JsonObject polling = report["polling"].to<JsonObject>();
+  polling["polls"] = session.polls;
+  polling["paused_ms"] = session.pollPausedMs;
+  polling["paused_max_ms"] = session.pollPausedMaxMs;
+}
+
+void handleApiUpdateStatus(AsyncWebServerRequest *request) {
+  PROFILE_ROUTE(ROUTE_UPDATE_GET);
+  if (!checkAuthentication(request)) return;
+  
+  beginRoute(ROUTE_UPDATE_GET);
+  JsonDocument doc(&jsonArena);
+  doc["image_state"] = imageStateNames[imageState];
+  doc["free_sketch_space"] = ESP.getFreeSketchSpace();
+  if (updateState == UPDATE_IDLE) {
+    doc["last_update"] = nullptr;
+  } else {
+    addUpdateReport(doc["last_update"].to<JsonObject>());
+  }
+  sendJson(request, ROUTE_UPDATE_GET, doc);
+}
+
+// POST /api/update?target=firmware|filesystem&md5=<32 hex digits>
+// Body: the raw .bin image (Content-Type: application/octet-stream)
+void handleApiUpdateBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+  PROFILE_ROUTE(ROUTE_UPDATE_POST);
+  if (index == 0) beginUpdate(request, total);
+  if (updateSession.request != request || updateState != UPDATE_RECEIVING) return;
+  
+  uint32_t writeStart = micros();
+  size_t written = Update.write(data, len);
+  updateSession.flashWriteUs += micros() - writeStart;
+  updateSession.written += written;
+  if (written != len) {
+    updateSession.updateError = Update.getError();
+    if (updateSession.updateError == UPDATE_ERROR_MAGIC_BYTE) {
+      failUpdate(400, "Not a firmware image");
+    } else {
+      failUpdate(500, "Flash write failed");
+    }
+    return;
+  }
+  if (updateSession.written == updateSession.size) finishUpdate();
+}
+
+// Runs once the whole body has been through handleApiUpdateBody()
+void handleApiUpdate(AsyncWebServerRequest *request) {
+  PROFILE_ROUTE(ROUTE_UPDATE_POST);
+  if (!checkAuthentication(request)) return;
+  
+  beginRoute(ROUTE_UPDATE_POST);
+  if (updateSession.request != request) {
+    if (updateState == UPDATE_RECEIVING) {
+      sendStaticJson(request, 409, PSTR("{\"error\":\"Another update is in progress\"}"));
+    } else {
+      sendStaticJson(request, 400, PSTR("{\"error\":\"Send the image as an application/octet-stream body\"}"));
+    }
+    return;
+  }
+  // Replaces the handler beginUpdate() set, so it is chained
+  auto release = [request]() { releaseUpdateRequest(request); };
+  
+  JsonDocument doc(&jsonArena);
+  bool success = updateState == UPDATE_SUCCESS;
+  doc["success"] = success;
+  addUpdateReport(doc["update"].to<JsonObject>());
+  if (!success) {
+    routeStats[ROUTE_UPDATE_POST].failures++;
+    sendJson(request, ROUTE_UPDATE_POST, doc, false, updateSession.httpCode, release);
+    return;
+  }
+  
+  doc["message"] = "Image verified. Device will restart in 2 seconds.";
+  sendJson(request, ROUTE_UPDATE_POST, doc, false, 200, release);
+  LOG_PORT.println(F("🔄 Restarting into the new image in 2 seconds..."));
+  scheduleRestart(2000, false);
+}
+
+#if PROFILER_ENABLED
+void handleDebugProfile(AsyncWebServerRequest *request) {
+  PROFILE_ROUTE(ROUTE_DEBUG_PROFILE);
+  if (!checkAuthentication(request)) return;
+  
+  routeStats[ROUTE_DEBUG_PROFILE].requests++;
+  largeArena.reset();
+  JsonDocument doc(&largeArena);
+  
+  doc["cpu_mhz"] = profilerCpuMHz();
+  doc["uptime_ms"] = millis();
+  
+  JsonObject tasks = doc["tasks"].to<JsonObject>();
+  JsonObject loopTask = tasks["loop"].to<JsonObject>();
+  for (int i = 0; i < LOOP_STAGE_COUNT; i++) {
+    loopProfile[i].toJson(loopTask[loopStageNames[i]].to<JsonObject>());
+  }
+#if PROFILER_HTTP_ROUTES
+  JsonObject httpTask = tasks["async_tcp"].to<JsonObject>();
+  for (int i = 0; i < ROUTE_COUNT; i++) {
+    httpProfile[i].toJson(httpTask[routeStats[i].path].to<JsonObject>());
+  }
+#endif
+  
+  sendJsonFrom(largeResponsePool, largeArena.used(), request, ROUTE_DEBUG_PROFILE, doc, false);
+}
+#endif
+
+// Determinar tipo de encriptação
+const char *getEncryptionText(int type) {
+  switch (type) {
+#ifdef ESP8266
+    case ENC_TYPE_NONE: return "Open";
+    case ENC_TYPE_WEP: return "WEP";
+    case ENC_TYPE_TKIP: return "WPA";
+    case ENC_TYPE_CCMP: return "WPA2";
+    case ENC_TYPE_AUTO: return "WPA/WPA2";
+#else
+    case WIFI_AUTH_OPEN: return "Open";
+    case WIFI_AUTH_WEP: return "WEP";
+    case WIFI_AUTH_WPA_PSK: return "WPA";
+    case WIFI_AUTH_WPA2_PSK: return "WPA2";
+    case WIFI_AUTH_WPA_WPA2_PSK: return "WPA/WPA2";
+    case WIFI_AUTH_WPA2_ENTERPRISE: return "WPA2-Enterprise";
+#endif
+    default: return "Unknown";
+  }
 }
 
 void handleNotFound(AsyncWebServerRequest *request) {
@@ -463,10 +2167,133 @@ void handleNotFound(AsyncWebServerRequest *request) {
 }
 
 // ==================== WIFI MANAGER ====================
+// Wi-Fi comes up in the background while the loop already polls Modbus:
+// saved credentials first, then the WiFiManager portal in non-blocking mode.
+// The HTTP server starts once the station link is up (until then the portal
+// owns port 80).
+enum WifiStage {
+  WIFI_STAGE_IDLE,
+  WIFI_STAGE_CONNECTING,  // WiFi.begin() with saved credentials
+  WIFI_STAGE_PORTAL,      // Captive portal running, serviced from loop()
+  WIFI_STAGE_CONNECTED
+};
+
+WifiStage wifiStage = WIFI_STAGE_IDLE;
+unsigned long wifiStageStart = 0;
+bool webServerStarted = false;
+
+// Portal fields for the API credentials; they must outlive setup()
+WiFiManagerParameter portalIntroText("<p>Configuração de credenciais da API</p>");
+WiFiManagerParameter portalApiUser("api_user", "Usuário API", DEFAULT_API_USER, 40);
+WiFiManagerParameter portalApiPass("api_pass", "Senha API", DEFAULT_API_PASS, 40);
+
 void configModeCallback(WiFiManager *myWiFiManager) {
-  Serial.println("Entered config mode");
-  Serial.println("AP IP: " + WiFi.softAPIP().toString());
-  Serial.println("SSID: " + String(AP_SSID));
+  LOG_PORT.println(F("Entered config mode"));
+  LOG_PRINTF("AP IP: %s\n", WiFi.softAPIP().toString().c_str());
+  LOG_PORT.println(F("SSID: " AP_SSID));
+}
+
+void savePortalCredentials() {
+  if (strlen(portalApiUser.getValue()) == 0) return;
+  
+  strlcpy(currentApiUser, portalApiUser.getValue(), sizeof(currentApiUser));
+  strlcpy(currentApiPass, portalApiPass.getValue(), sizeof(currentApiPass));
+  prefs.begin("credentials", false);
+  prefs.putString("api_user", currentApiUser);
+  prefs.putString("api_pass", currentApiPass);
+  prefs.end();
+  LOG_PORT.println(F("✓ API credentials saved"));
+}
+
+void startConfigPortal() {
+  LOG_PORT.println(F("Starting WiFiManager portal (non-blocking)..."));
+  wifiManager.startConfigPortal(AP_SSID, AP_PASSWORD);
+  wifiStage = WIFI_STAGE_PORTAL;
+  wifiStageStart = millis();
+}
+
+void startWifi() {
+  char savedSSID[SSID_MAX_LEN] = "";
+  char savedPassword[65] = "";
+  prefs.begin("wifi", true);  // Read-only mode
+  prefs.getString("ssid", savedSSID, sizeof(savedSSID));
+  prefs.getString("password", savedPassword, sizeof(savedPassword));
+  prefs.end();
+  
+  WiFi.mode(WIFI_STA);
+  if (strlen(savedSSID) > 0) {
+    LOG_PORT.println(F("Found saved WiFi credentials:"));
+    LOG_PRINTF("  SSID: %s\n", savedSSID);
+    WiFi.begin(savedSSID, savedPassword);
+  } else if (wifiManager.getWiFiIsSaved()) {
+    LOG_PORT.println(F("Connecting with the network saved by the portal..."));
+    WiFi.begin();
+  } else {
+    startConfigPortal();
+    return;
+  }
+  wifiStage = WIFI_STAGE_CONNECTING;
+  wifiStageStart = millis();
+}
+
+void onWifiConnected() {
+  // The portal's web server must let go of port 80 first
+  if (wifiManager.getConfigPortalActive()) wifiManager.stopConfigPortal();
+  
+  wifiStage = WIFI_STAGE_CONNECTED;
+  if (!bootTiming.wifiConnectedMs) bootTiming.wifiConnectedMs = millis();
+  strlcpy(connectedSSID, WiFi.SSID().c_str(), sizeof(connectedSSID));
+  
+  LOG_PORT.println(F("✓ WiFi connected!"));
+  LOG_PORT.print(F("  IP address: "));
+  LOG_PORT.println(WiFi.localIP());
+  LOG_PORT.print(F("  SSID: "));
+  LOG_PORT.println(connectedSSID);
+  
+  if (!webServerStarted) {
+    server.begin();
+    webServerStarted = true;
+    bootTiming.httpReadyMs = millis();
+    LOG_PORT.println(F("✓ HTTP server started"));
+    
+    LOG_PORT.println(F("\n================================="));
+    LOG_PORT.println(F("Device ready!"));
+    LOG_PRINTF("Access: http://%s\n", WiFi.localIP().toString().c_str());
+    LOG_PORT.println(F("API: /api/sensors"));
+    LOG_PRINTF("Boot: first poll %lu ms, HTTP ready %lu ms\n", bootTiming.firstPollMs, bootTiming.httpReadyMs);
+    LOG_PORT.println(F("=================================\n"));
+  }
+}
+
+// Called every loop iteration; never blocks
+void serviceWifi() {
+  switch (wifiStage) {
+    case WIFI_STAGE_CONNECTING:
+      if (WiFi.status() == WL_CONNECTED) {
+        onWifiConnected();
+      } else if (millis() - wifiStageStart > WIFI_CONNECT_TIMEOUT_MS) {
+        LOG_PORT.println(F("✗ Failed to connect with saved credentials"));
+        LOG_PORT.println(F("  Falling back to WiFiManager..."));
+        WiFi.disconnect();
+        startConfigPortal();
+      }
+      break;
+      
+    case WIFI_STAGE_PORTAL:
+      wifiManager.process();
+      if (WiFi.status() == WL_CONNECTED) {
+        onWifiConnected();
+      } else if (!wifiManager.getConfigPortalActive()) {
+        // Portal timed out: retry the saved network, then the portal again.
+        // Telemetry keeps running, so there is no reason to restart.
+        LOG_PORT.println(F("Config portal timed out - retrying WiFi"));
+        startWifi();
+      }
+      break;
+      
+    default:
+      break;
+  }
 }
 
 // ==================== FACTORY RESET ====================
@@ -474,12 +2301,12 @@ void checkFactoryReset() {
   if (digitalRead(FACTORY_RESET_PIN) == LOW) {
     if (resetButtonPressed == 0) {
       resetButtonPressed = millis();
-      Serial.println("Factory reset button pressed...");
+      LOG_PORT.println(F("Factory reset button pressed..."));
     }
     
     if (millis() - resetButtonPressed > 5000 && !resetInProgress) {
       resetInProgress = true;
-      Serial.println("FACTORY RESET TRIGGERED!");
+      LOG_PORT.println(F("FACTORY RESET TRIGGERED!"));
       
       // Clear WiFi credentials
       wifiManager.resetSettings();
@@ -489,7 +2316,7 @@ void checkFactoryReset() {
       prefs.clear();
       prefs.end();
       
-      Serial.println("All settings cleared. Restarting...");
+      LOG_PORT.println(F("All settings cleared. Restarting..."));
       delay(1000);
       ESP.restart();
     }
@@ -499,134 +2326,105 @@ void checkFactoryReset() {
   }
 }
 
+// ==================== MEMORY BUDGET ====================
+// The firmware's own static buffers, summed at compile time: a profile that
+// outgrows STATIC_RAM_BUDGET (config.h) fails the build, not the heap later
+constexpr size_t STATIC_BUFFER_BYTES =
+    sizeof(jsonArena) + sizeof(responsePool) +
+#if !LEAN_PROFILE
+    sizeof(largeArena) + sizeof(largeResponsePool) +
+#endif
+#if PROFILER_ENABLED
+    sizeof(loopProfile) +
+#endif
+#if PROFILER_ENABLED && PROFILER_HTTP_ROUTES
+    sizeof(httpProfile) +
+#endif
+    sizeof(rollingStats) + sizeof(burstRing) + sizeof(modbus) + sizeof(prefs) +
+    sizeof(sensorData) + sizeof(publishedValues) + sizeof(fieldChangeSeq) + sizeof(activePoints);
+static_assert(STATIC_BUFFER_BYTES <= STATIC_RAM_BUDGET, "static buffers exceed STATIC_RAM_BUDGET (config.h)");
+
 // ==================== SETUP ====================
+// Telemetry first: Modbus is polling within a few hundred ms of power-on,
+// Wi-Fi and the HTTP server follow from loop() via serviceWifi()
 void setup() {
-  Serial.begin(115200);
-  delay(1000);
+  LOG_PORT.begin(115200);
   
-  Serial.println("\n\n=================================");
-  Serial.println("   MUST Inverter API Device");
-  Serial.println("   PlatformIO C++ Version");
-  Serial.println("=================================\n");
+  LOG_PORT.println(F("\n\n================================="));
+  LOG_PORT.println(F("   MUST Inverter API Device"));
+  LOG_PORT.println(F("   PlatformIO C++ Version"));
+  LOG_PORT.println(F("=================================\n"));
   
   // Configure factory reset button
   pinMode(FACTORY_RESET_PIN, INPUT_PULLUP);
   
+  // Initialize LittleFS (first: it also holds the settings on the ESP8266)
+#ifdef ESP8266
+  bool fsMounted = LittleFS.begin();  // Formats an unreadable partition itself
+#else
+  bool fsMounted = LittleFS.begin(true);
+#endif
+  if (!fsMounted) {
+    LOG_PORT.println(F("✗ LittleFS mount failed!"));
+    LOG_PORT.println(F("  Please upload filesystem with: pio run --target uploadfs"));
+  } else {
+    LOG_PORT.println(F("✓ LittleFS mounted"));
+  }
+  
   // Load saved credentials from Preferences
   prefs.begin("credentials", true);  // Read-only mode
-  currentApiUser = prefs.getString("api_user", DEFAULT_API_USER);
-  currentApiPass = prefs.getString("api_pass", DEFAULT_API_PASS);
+  prefs.getString("api_user", currentApiUser, sizeof(currentApiUser));
+  prefs.getString("api_pass", currentApiPass, sizeof(currentApiPass));
   prefs.end();
   
-  Serial.println("✓ Credentials loaded:");
-  Serial.printf("   Username: %s\n", currentApiUser.c_str());
-  Serial.println("   Password: ***");
-  
-  // Initialize LittleFS
-  if (!LittleFS.begin(true)) {
-    Serial.println("✗ LittleFS mount failed!");
-    Serial.println("  Please upload filesystem with: pio run --target uploadfs");
+  LOG_PORT.println(F("✓ Credentials loaded:"));
+  LOG_PRINTF("   Username: %s\n", currentApiUser);
+  LOG_PORT.println(F("   Password: ***"));
+  
+  initSnapshotSeq();
+  initRollingStats();
+  initInverterProfile();
+  initBurstCapture();
+  initImageState();
+  
+  // Initialize Modbus (UART event driven, DE/RE handled by the driver)
+#ifdef ESP8266
+  if (modbus.begin(MODBUS_SERIAL, MODBUS_BAUD)) {
+#else
+  if (modbus.begin((uart_port_t)MODBUS_UART_NUM, MODBUS_TX_PIN, MODBUS_RX_PIN, MODBUS_BAUD)) {
+#endif
+    LOG_PORT.println(F("✓ Modbus RTU initialized"));
   } else {
-    Serial.println("✓ LittleFS mounted");
+    LOG_PORT.println(F("✗ Modbus RTU UART setup failed!"));
   }
-  
-  // Initialize Modbus
-  MODBUS_SERIAL.begin(19200, SERIAL_8N1, MODBUS_RX_PIN, MODBUS_TX_PIN);
-  
   #ifdef MODBUS_FLOW_CONTROL_ENABLED
-    // Configure DE/RE pins for RS485 flow control
-    pinMode(MODBUS_DE_PIN, OUTPUT);
-    pinMode(MODBUS_RE_PIN, OUTPUT);
-    digitalWrite(MODBUS_DE_PIN, LOW);  // Disable transmit by default
-    digitalWrite(MODBUS_RE_PIN, LOW);  // Enable receive by default
-    Serial.printf("✓ RS485 flow control enabled (DE/RE: GPIO%d)\n", MODBUS_DE_PIN);
+    LOG_PRINTF("✓ RS485 flow control enabled (DE/RE: GPIO%d)\n", MODBUS_DE_PIN);
   #endif
   
-  modbus.begin(&MODBUS_SERIAL);
-  modbus.master();
-  Serial.println("✓ Modbus RTU initialized");
-  
-  #if defined(CONFIG_IDF_TARGET_ESP32C3)
-    Serial.println("  Platform: ESP32-C3");
+  #if defined(ESP8266)
+    LOG_PORT.println(F("  Platform: ESP8266"));
+  #elif defined(CONFIG_IDF_TARGET_ESP32C3)
+    LOG_PORT.println(F("  Platform: ESP32-C3"));
   #elif defined(CONFIG_IDF_TARGET_ESP32S3)
-    Serial.println("  Platform: ESP32-S3");
+    LOG_PORT.println(F("  Platform: ESP32-S3"));
   #else
-    Serial.println("  Platform: ESP32");
+    LOG_PORT.println(F("  Platform: ESP32"));
   #endif
-  Serial.printf("  Pins: TX=%d, RX=%d\n", MODBUS_TX_PIN, MODBUS_RX_PIN);
-  
-  // Configure WiFiManager
+  LOG_PRINTF("  Pins: TX=%d, RX=%d\n", MODBUS_TX_PIN, MODBUS_RX_PIN);
+  bootTiming.modbusReadyMs = millis();
+  
+  // Configure WiFiManager (serviced from loop(), never blocks)
+#ifdef ESP8266
+  // Its debug port is Serial, which carries Modbus here
+  wifiManager.setDebugOutput(false);
+#endif
   wifiManager.setAPCallback(configModeCallback);
   wifiManager.setConfigPortalTimeout(180);  // 3 minutes timeout
-  
-  // Check if we have saved WiFi credentials
-  prefs.begin("wifi", true);  // Read-only mode
-  String savedSSID = prefs.getString("ssid", "");
-  String savedPassword = prefs.getString("password", "");
-  prefs.end();
-  
-  // Try to connect with saved credentials first
-  if (savedSSID.length() > 0) {
-    Serial.println("Found saved WiFi credentials:");
-    Serial.printf("  SSID: %s\n", savedSSID.c_str());
-    Serial.println("Attempting to connect...");
-    
-    WiFi.begin(savedSSID.c_str(), savedPassword.c_str());
-    
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < 20) {  // 10 seconds timeout
-      delay(500);
-      Serial.print(".");
-      attempts++;
-    }
-    Serial.println();
-    
-    if (WiFi.status() == WL_CONNECTED) {
-      Serial.println("✓ WiFi connected using saved credentials!");
-      Serial.print("  IP address: ");
-      Serial.println(WiFi.localIP());
-    } else {
-      Serial.println("✗ Failed to connect with saved credentials");
-      Serial.println("  Falling back to WiFiManager...");
-      WiFi.disconnect();
-    }
-  }
-  
-  // If not connected, use WiFiManager
-  if (WiFi.status() != WL_CONNECTED) {
-    // Custom parameters for API credentials
-    WiFiManagerParameter custom_text("<p>Configuração de credenciais da API</p>");
-    WiFiManagerParameter api_user("api_user", "Usuário API", DEFAULT_API_USER, 40);
-    WiFiManagerParameter api_pass("api_pass", "Senha API", DEFAULT_API_PASS, 40);
-    
-    wifiManager.addParameter(&custom_text);
-    wifiManager.addParameter(&api_user);
-    wifiManager.addParameter(&api_pass);
-    
-    // Try to connect
-    Serial.println("Starting WiFiManager...");
-    if (!wifiManager.autoConnect(AP_SSID, AP_PASSWORD)) {
-      Serial.println("Failed to connect and hit timeout");
-      delay(3000);
-      ESP.restart();
-    }
-    
-    Serial.println("✓ WiFi connected via WiFiManager!");
-  }
-  
-  Serial.print("  IP address: ");
-  Serial.println(WiFi.localIP());
-  Serial.print("  SSID: ");
-  Serial.println(WiFi.SSID());
-  
-  // Save API credentials if provided
-  if (strlen(api_user.getValue()) > 0) {
-    prefs.begin("credentials", false);
-    prefs.putString("api_user", api_user.getValue());
-    prefs.putString("api_pass", api_pass.getValue());
-    prefs.end();
-    Serial.println("✓ API credentials saved");
-  }
+  wifiManager.setConfigPortalBlocking(false);
+  wifiManager.setSaveParamsCallback(savePortalCredentials);
+  wifiManager.addParameter(&portalIntroText);
+  wifiManager.addParameter(&portalApiUser);
+  wifiManager.addParameter(&portalApiPass);
   
   // Setup web server routes
   server.on("/", HTTP_GET, handleRoot);
@@ -639,43 +2437,77 @@ void setup() {
   
   server.on("/api/sensors", HTTP_GET, handleApiSensors);
   server.on("/api/status", HTTP_GET, handleApiStatus);
+  server.on("/api/stats", HTTP_GET, handleApiStats);
+  server.on("/api/burst", HTTP_GET, handleApiBurst);
+  server.on("/api/burst/arm", HTTP_POST,
+    [](AsyncWebServerRequest *request) {
+      // Empty body: manual trigger with defaults
+      if (request->contentLength() == 0) handleApiBurstArm(request, NULL, 0, 0, 0);
+    },
+    NULL,
+    handleApiBurstArm  // Body handler
+  );
+  server.on("/api/burst/trigger", HTTP_POST, handleApiBurstTrigger);
+  server.on("/api/burst/cancel", HTTP_POST, handleApiBurstCancel);
+  server.on("/api/burst/data", HTTP_GET, handleApiBurstData);
+  server.on("/api/update", HTTP_GET, handleApiUpdateStatus);
+  server.on("/api/update", HTTP_POST, handleApiUpdate, NULL, handleApiUpdateBody);
+#if PROFILER_ENABLED
+  server.on("/api/debug/profile", HTTP_GET, handleDebugProfile);
+#endif
   
   // Credentials endpoint (GET - retorna configurações atuais)
   server.on("/api/credentials", HTTP_GET, [](AsyncWebServerRequest *request) {
+    PROFILE_ROUTE(ROUTE_CREDENTIALS_GET);
     if (!checkAuthentication(request)) return;
     
-    JsonDocument doc;
+    beginRoute(ROUTE_CREDENTIALS_GET);
+    JsonDocument doc(&jsonArena);
     doc["username"] = currentApiUser;
     
     // Carregar WiFi SSID do Preferences se existir
+    char savedSSID[SSID_MAX_LEN] = "";
+    char savedPassword[65] = "";
     prefs.begin("wifi", true);
-    String savedSSID = prefs.getString("ssid", "");
-    String savedPassword = prefs.getString("password", "");
+    prefs.getString("ssid", savedSSID, sizeof(savedSSID));
+    prefs.getString("password", savedPassword, sizeof(savedPassword));
     prefs.end();
     
-    if (savedSSID.length() > 0) {
+    if (strlen(savedSSID) > 0) {
       doc["wifi_ssid"] = savedSSID;
-      doc["has_wifi_password"] = savedPassword.length() > 0;
+      doc["has_wifi_password"] = strlen(savedPassword) > 0;
     } else {
       doc["wifi_ssid"] = nullptr;
       doc["has_wifi_password"] = false;
     }
     
-    String response;
-    serializeJson(doc, response);
-    request->send(200, "application/json", response);
+    sendJson(request, ROUTE_CREDENTIALS_GET, doc);
   });
   
   // WiFi scan endpoint (GET - escaneia redes disponíveis)
   server.on("/api/wifi/scan", HTTP_GET, [](AsyncWebServerRequest *request) {
+    PROFILE_ROUTE(ROUTE_WIFI_SCAN);
     if (!checkAuthentication(request)) return;
     
-    Serial.println("🔍 Scanning WiFi networks (2.4 GHz only)...");
+    LOG_PORT.println(F("🔍 Scanning WiFi networks (2.4 GHz only)..."));
     
     // Fazer scan de redes
+#ifdef ESP8266
+    // A blocking scan would delay() inside the TCP callback: scan in the
+    // background and answer 202 until the results are in
+    int networksFound = WiFi.scanComplete();
+    if (networksFound < 0) {
+      if (networksFound == WIFI_SCAN_FAILED) WiFi.scanNetworks(true);
+      routeStats[ROUTE_WIFI_SCAN].requests++;
+      sendStaticJson(request, 202, PSTR("{\"success\":true,\"scanning\":true}"));
+      return;
+    }
+#else
     int networksFound = WiFi.scanNetworks();
+#endif
     
-    JsonDocument doc;
+    beginRoute(ROUTE_WIFI_SCAN);
+    JsonDocument doc(&jsonArena);
     doc["success"] = true;
     
     JsonArray networks = doc["networks"].to<JsonArray>();
@@ -688,33 +2520,21 @@ void setup() {
       // ESP32 não suporta 5 GHz (canais > 14)
       if (channel >= 1 && channel <= 14) {
         JsonObject network = networks.add<JsonObject>();
-        network["ssid"] = WiFi.SSID(i);
+#ifdef ESP8266
+        // bss_info SSIDs are not NUL-terminated at full length
+        bss_info *record = (bss_info *)WiFi.getScanInfoByIndex(i);
+        char ssid[SSID_MAX_LEN];
+        size_t ssidLen = min((size_t)record->ssid_len, sizeof(ssid) - 1);
+        memcpy(ssid, record->ssid, ssidLen);
+        ssid[ssidLen] = '\0';
+        network["ssid"] = ssid;  // char[]: copied into the document
+#else
+        wifi_ap_record_t *record = (wifi_ap_record_t *)WiFi.getScanInfoByIndex(i);
+        network["ssid"] = (const char *)record->ssid;
+#endif
         network["rssi"] = WiFi.RSSI(i);
         network["channel"] = channel;
-        
-        // Determinar tipo de encriptação
-        switch (WiFi.encryptionType(i)) {
-          case WIFI_AUTH_OPEN:
-            network["encryption"] = "Open";
-            break;
-          case WIFI_AUTH_WEP:
-            network["encryption"] = "WEP";
-            break;
-          case WIFI_AUTH_WPA_PSK:
-            network["encryption"] = "WPA";
-            break;
-          case WIFI_AUTH_WPA2_PSK:
-            network["encryption"] = "WPA2";
-            break;
-          case WIFI_AUTH_WPA_WPA2_PSK:
-            network["encryption"] = "WPA/WPA2";
-            break;
-          case WIFI_AUTH_WPA2_ENTERPRISE:
-            network["encryption"] = "WPA2-Enterprise";
-            break;
-          default:
-            network["encryption"] = "Unknown";
-        }
+        network["encryption"] = getEncryptionText(WiFi.encryptionType(i));
         count24GHz++;
       }
     }
@@ -722,15 +2542,13 @@ void setup() {
     doc["count"] = count24GHz;
     doc["note"] = "Only 2.4 GHz networks (ESP32 compatible)";
     
-    // Limpar scan
-    WiFi.scanDelete();
-    
-    String response;
-    serializeJson(doc, response);
+    LOG_PRINTF("✓ Found %d networks (2.4 GHz)\n", count24GHz);
     
-    Serial.printf("✓ Found %d networks (2.4 GHz)\n", count24GHz);
+    // Serialize before the scan records (and their SSIDs) are freed
+    sendJson(request, ROUTE_WIFI_SCAN, doc);
     
-    request->send(200, "application/json", response);
+    // Limpar scan
+    WiFi.scanDelete();
   });
   
   // Credentials endpoint (POST - altera credenciais)
@@ -749,41 +2567,89 @@ void setup() {
   
   // Config portal redirect (for reconfiguring WiFi)
   server.on("/config", HTTP_GET, [](AsyncWebServerRequest *request) {
-    Serial.println("Config portal requested - restarting in AP mode...");
+    LOG_PORT.println(F("Config portal requested - restarting in AP mode..."));
     request->send(200, "text/plain", "Restarting in configuration mode...");
-    delay(1000);
-    wifiManager.resetSettings();
-    ESP.restart();
+    scheduleRestart(1000, true);
   });
   
   server.onNotFound(handleNotFound);
   
-  server.begin();
-  Serial.println("✓ HTTP server started");
-  
-  Serial.println("\n=================================");
-  Serial.println("Device ready!");
-  Serial.println("Access: http://" + WiFi.localIP().toString());
-  Serial.println("API: /api/sensors");
-  Serial.println("=================================\n");
+  // Routes are registered; server.begin() runs once Wi-Fi is up
+  startWifi();
+  LOG_PRINTF("✓ Setup done in %lu ms - polling Modbus, WiFi connecting in background\n", millis());
 }
 
 // ==================== LOOP ====================
-unsigned long lastModbusUpdate = 0;
-const unsigned long MODBUS_UPDATE_INTERVAL = 5000;  // 5 seconds
-
 void loop() {
+  // Whole iteration, including the trailing delay(10)
+  PROFILE_SCOPE(loopProfile[LOOP_CYCLE]);
+  
   // Check factory reset button
-  checkFactoryReset();
+  {
+    PROFILE_SCOPE(loopProfile[LOOP_FACTORY_RESET]);
+    checkFactoryReset();
+  }
+  serviceRestart();
+  serviceImageVerification();
   
-  // Update sensor data periodically
-  if (millis() - lastModbusUpdate > MODBUS_UPDATE_INTERVAL) {
+  {
+    PROFILE_SCOPE(loopProfile[LOOP_WIFI]);
+    serviceWifi();
+  }
+  
+  // While a burst capture runs it owns the bus; normal polling resumes after
+  if (burstRing.active()) {
+    PROFILE_SCOPE(loopProfile[LOOP_BURST_SAMPLE]);
+    sampleBurst();
+    return;
+  }
+  
+  // Probe before the first poll when nothing is cached, or once the cached
+  // profile stopped getting answers. Demo mode does not stop it: a model the
+  // current map cannot reach (EP3000Plus has no 15201) only ever answers the
+  // probe. Not while an image comes in: the probe is extra bus time and
+  // saves to settings. One register per pass, the poll waits.
+  bool probeDue = profileProbePending && updateState != UPDATE_RECEIVING &&
+                  (!profileProbeFailedMs || millis() - profileProbeFailedMs >= PROFILE_PROBE_RETRY_MS);
+  if (probeDue) {
+    PROFILE_SCOPE(loopProfile[LOOP_SENSOR_UPDATE]);
+    if (stepInverterProfileProbe() && burstRing.state() == BurstRingType::IDLE) resolveBurstChannels();
+  }
+  
+  // Update sensor data periodically (right away after boot). While an image
+  // comes in the poll backs off: its bus and CPU time go to the transfer.
+  unsigned long pollInterval = updateState == UPDATE_RECEIVING ? OTA_POLL_INTERVAL_MS : MODBUS_UPDATE_INTERVAL;
+  if (!probeDue && (!bootTiming.firstPollMs || millis() - lastModbusUpdate > pollInterval)) {
+    PROFILE_SCOPE(loopProfile[LOOP_SENSOR_UPDATE]);
+    unsigned long pollStart = millis();
+    if (sensorData.lastPollStart > 0) {
+      sensorData.pollIntervalMs = pollStart - sensorData.lastPollStart;
+    }
+    sensorData.lastPollStart = pollStart;
+    if (updateState == UPDATE_RECEIVING && lastModbusUpdate) {
+      // Paused = late against the regular schedule, back-off included
+      recordUpdatePoll(pollStart - lastModbusUpdate - MODBUS_UPDATE_INTERVAL);
+    }
+    
     updateSensorData();
+    publishSensorSnapshot();
+    // Only real readings: failed reads leave stale values behind and demo
+    // values are made up
+    if (!sensorData.modbusError && !sensorData.demoMode) {
+      updateRollingStats();
+    }
     lastModbusUpdate = millis();
+    
+    if (!bootTiming.firstPollMs) bootTiming.firstPollMs = lastModbusUpdate;
+    if (!bootTiming.firstSampleMs && !sensorData.modbusError && !sensorData.demoMode) {
+      bootTiming.firstSampleMs = lastModbusUpdate;
+    }
+    
+    sensorData.pollDurationMs = lastModbusUpdate - pollStart;
+    if (sensorData.pollDurationMs > sensorData.pollDurationMaxMs) {
+      sensorData.pollDurationMaxMs = sensorData.pollDurationMs;
+    }
   }
   
-  // Keep Modbus task running
-  modbus.task();
-  
   delay(10);
 }
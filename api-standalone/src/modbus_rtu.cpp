@@ -0,0 +1,400 @@
+#include "modbus_rtu.h"
+
+// CRC-16/MODBUS (reflected 0xA001), one table lookup per byte; kept in
+// flash on the ESP8266
+static const uint16_t crcTable[256] PROGMEM = {
+  0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+  0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+  0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+  0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+  0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+  0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+  0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+  0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+  0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+  0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+  0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+  0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+  0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+  0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+  0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+  0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+  0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+  0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+  0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+  0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+  0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+  0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+  0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+  0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+  0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+  0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+  0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+  0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+  0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+  0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+  0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+  0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040,
+};
+
+uint16_t ModbusRtuMaster::crc16(const uint8_t *data, size_t length) {
+  uint16_t crc = 0xFFFF;
+  while (length--) crc = (crc >> 8) ^ pgm_read_word(&crcTable[(crc ^ *data++) & 0xFF]);
+  return crc;
+}
+
+const char *ModbusRtuMaster::resultName(ModbusResult result) {
+  static const char *const names[MODBUS_RESULT_COUNT] = {
+    "ok", "timeout", "crc_error", "exception", "invalid_response", "bus_error", "busy",
+  };
+  return result < MODBUS_RESULT_COUNT ? names[result] : "unknown";
+}
+
+// ---- Frame pool (caller side only, under bus_)
+
+ModbusFrame *ModbusRtuMaster::acquireFrame() {
+  for (uint8_t i = 0; i < MODBUS_FRAME_POOL; i++) {
+    if (!frames_[i].busy) {
+      frames_[i].busy = true;
+      frames_[i].length = 0;
+      return &frames_[i];
+    }
+  }
+  return nullptr;
+}
+
+void ModbusRtuMaster::releaseFrame(ModbusFrame *frame) {
+  if (frame) frame->busy = false;
+}
+
+// ---- Transactions
+
+ModbusResult ModbusRtuMaster::readHreg(uint8_t slave, uint16_t address, uint16_t *values, uint16_t count) {
+  if (count == 0 || 5 + 2 * count > MODBUS_FRAME_SIZE) return MODBUS_INVALID_RESPONSE;
+  if (!lockBus()) return MODBUS_BUSY;
+
+  ModbusFrame *request = acquireFrame();
+  ModbusFrame *response = acquireFrame();
+  ModbusResult result = MODBUS_BUSY;
+  if (request && response) {
+    uint8_t *pdu = request->data;
+    pdu[0] = slave;
+    pdu[1] = 0x03;
+    pdu[2] = address >> 8;
+    pdu[3] = address & 0xFF;
+    pdu[4] = count >> 8;
+    pdu[5] = count & 0xFF;
+    request->length = 6;
+
+    result = transact(request, response);
+    if (result == MODBUS_OK) {
+      const uint8_t *data = response->data;
+      if (data[1] != 0x03 || data[2] != 2 * count || response->length != 5 + 2 * count) {
+        result = MODBUS_INVALID_RESPONSE;
+      } else {
+        for (uint16_t i = 0; i < count; i++) values[i] = data[3 + 2 * i] << 8 | data[4 + 2 * i];
+      }
+    }
+  }
+
+  releaseFrame(request);
+  releaseFrame(response);
+  unlockBus();
+  return result;
+}
+
+ModbusResult ModbusRtuMaster::writeHreg(uint8_t slave, uint16_t address, uint16_t value) {
+  if (!lockBus()) return MODBUS_BUSY;
+
+  ModbusFrame *request = acquireFrame();
+  ModbusFrame *response = acquireFrame();
+  ModbusResult result = MODBUS_BUSY;
+  if (request && response) {
+    uint8_t *pdu = request->data;
+    pdu[0] = slave;
+    pdu[1] = 0x06;
+    pdu[2] = address >> 8;
+    pdu[3] = address & 0xFF;
+    pdu[4] = value >> 8;
+    pdu[5] = value & 0xFF;
+    request->length = 6;
+
+    result = transact(request, response);
+    // The slave echoes the request (CRC included)
+    if (result == MODBUS_OK &&
+        (response->length != request->length || memcmp(response->data, request->data, request->length) != 0)) {
+      result = MODBUS_INVALID_RESPONSE;
+    }
+  }
+
+  releaseFrame(request);
+  releaseFrame(response);
+  unlockBus();
+  return result;
+}
+
+// Append the CRC, run the exchange on the transport and check the answer.
+// Called with the bus held.
+ModbusResult ModbusRtuMaster::transact(ModbusFrame *request, ModbusFrame *response) {
+  uint16_t crc = crc16(request->data, request->length);
+  request->data[request->length++] = crc & 0xFF;
+  request->data[request->length++] = crc >> 8;
+
+  uint32_t startUs = micros();
+  ModbusResult result = exchange(request, response);
+  if (result != MODBUS_OK) return finish(result, startUs);
+
+  const uint8_t *data = response->data;
+  if (response->length < 5) return finish(MODBUS_INVALID_RESPONSE, startUs);
+  uint16_t received = data[response->length - 2] | data[response->length - 1] << 8;
+  if (crc16(data, response->length - 2) != received) return finish(MODBUS_CRC_ERROR, startUs);
+  if (data[0] != request->data[0]) return finish(MODBUS_INVALID_RESPONSE, startUs);
+  if (data[1] == (request->data[1] | 0x80)) {
+    stats_.lastException = data[2];
+    return finish(MODBUS_EXCEPTION, startUs);
+  }
+  return finish(MODBUS_OK, startUs);
+}
+
+ModbusResult ModbusRtuMaster::finish(ModbusResult result, uint32_t startUs) {
+  uint32_t latency = micros() - startUs;
+  stats_.transactions++;
+  stats_.results[result]++;
+  if (result != MODBUS_TIMEOUT) {
+    stats_.lastLatencyUs = latency;
+    if (latency > stats_.maxLatencyUs) stats_.maxLatencyUs = latency;
+  }
+  return result;
+}
+
+#ifdef ESP8266
+
+// ---- HardwareSerial transport (ESP8266)
+
+void ModbusRtuMaster::setTransmit(bool transmit) {
+#ifdef MODBUS_FLOW_CONTROL_ENABLED
+  // DE high enables the driver, RE high disables the receiver (active low)
+  digitalWrite(MODBUS_DE_PIN, transmit ? HIGH : LOW);
+  digitalWrite(MODBUS_RE_PIN, transmit ? HIGH : LOW);
+#endif
+}
+
+bool ModbusRtuMaster::begin(HardwareSerial &serial, uint32_t baud) {
+  serial_ = &serial;
+  // The core's UART interrupt only empties the FIFO on its own 2-character
+  // RX timeout, so bytes show up in bursts: allow for that on top of the
+  // frame gap (11 bits per character: start, 8 data, stop, idle margin)
+  charUs_ = 11 * 1000000UL / baud;
+  frameGapUs_ = (MODBUS_RX_TIMEOUT_CHARS + 2) * charUs_;
+  serial_->begin(baud, SERIAL_8N1);
+
+#ifdef MODBUS_FLOW_CONTROL_ENABLED
+  pinMode(MODBUS_DE_PIN, OUTPUT);
+  pinMode(MODBUS_RE_PIN, OUTPUT);
+  setTransmit(false);
+#endif
+  return true;
+}
+
+// Only the loop task talks to the bus; HTTP callbacks never do
+bool ModbusRtuMaster::lockBus() { return true; }
+void ModbusRtuMaster::unlockBus() {}
+
+ModbusResult ModbusRtuMaster::exchange(const ModbusFrame *request, ModbusFrame *response) {
+  // Stale bytes are noise or a late answer to an earlier request
+  while (serial_->available()) serial_->read();
+  serial_->hasOverrun();
+
+  setTransmit(true);
+  serial_->write(request->data, request->length);
+  serial_->flush();  // Returns once the last stop bit is out
+  setTransmit(false);
+
+  // Without DE/RE control the transceiver hears the request too. That copy
+  // came in during the write; a real answer is still t3.5 away.
+  if (serial_->available()) {
+    delayMicroseconds(charUs_);  // Last echoed byte still being sampled
+    for (size_t i = 0; i < request->length && serial_->available(); i++) serial_->read();
+  }
+
+  response->length = 0;
+  uint32_t startMs = millis();
+  uint32_t lastByteUs = 0;
+  for (;;) {
+    int available = serial_->available();
+    if (available > 0) {
+      size_t room = sizeof(response->data) - response->length;
+      if ((size_t)available > room) return MODBUS_INVALID_RESPONSE;
+      response->length += serial_->readBytes(response->data + response->length, available);
+      lastByteUs = micros();
+    } else if (response->length > 0 && micros() - lastByteUs > frameGapUs_) {
+      return serial_->hasOverrun() ? MODBUS_BUS_ERROR : MODBUS_OK;
+    } else if (millis() - startMs > MODBUS_TIMEOUT_MS) {
+      return MODBUS_TIMEOUT;
+    } else {
+      yield();  // Keep Wi-Fi and the async TCP stack running
+    }
+  }
+}
+
+#else
+
+// ---- UART driver transport (ESP32)
+
+bool ModbusRtuMaster::begin(uart_port_t port, int txPin, int rxPin, uint32_t baud) {
+  port_ = port;
+  bus_ = xSemaphoreCreateMutexStatic(&busBuffer_);
+  rxLock_ = xSemaphoreCreateMutexStatic(&rxLockBuffer_);
+  done_ = xSemaphoreCreateBinaryStatic(&doneBuffer_);
+
+  uart_config_t config = {};
+  config.baud_rate = baud;
+  config.data_bits = UART_DATA_8_BITS;
+  config.parity = UART_PARITY_DISABLE;
+  config.stop_bits = UART_STOP_BITS_1;
+  config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+  config.source_clk = UART_SCLK_APB;
+
+#ifdef MODBUS_FLOW_CONTROL_ENABLED
+  // DE on RTS: in RS485 half-duplex mode the UART raises it for exactly the
+  // transmission and keeps its receiver deaf to our own echo meanwhile
+  int rtsPin = MODBUS_DE_PIN;
+  uart_mode_t mode = UART_MODE_RS485_HALF_DUPLEX;
+#else
+  int rtsPin = UART_PIN_NO_CHANGE;
+  uart_mode_t mode = UART_MODE_UART;
+#endif
+
+  if (uart_driver_install(port_, MODBUS_UART_RX_BUFFER, 0, MODBUS_UART_EVENT_QUEUE, &events_, 0) != ESP_OK ||
+      uart_param_config(port_, &config) != ESP_OK ||
+      uart_set_pin(port_, txPin, rxPin, rtsPin, UART_PIN_NO_CHANGE) != ESP_OK ||
+      uart_set_mode(port_, mode) != ESP_OK ||
+      uart_set_rx_timeout(port_, MODBUS_RX_TIMEOUT_CHARS) != ESP_OK) {
+    return false;
+  }
+
+#if defined(MODBUS_FLOW_CONTROL_ENABLED) && MODBUS_RE_PIN != MODBUS_DE_PIN
+  // Separate RE (active low): receiver always on
+  pinMode(MODBUS_RE_PIN, OUTPUT);
+  digitalWrite(MODBUS_RE_PIN, LOW);
+#endif
+
+  return xTaskCreate(eventTask, "modbus_rtu", MODBUS_EVENT_TASK_STACK, this,
+                     MODBUS_EVENT_TASK_PRIORITY, nullptr) == pdPASS;
+}
+
+bool ModbusRtuMaster::lockBus() {
+  return xSemaphoreTake(bus_, pdMS_TO_TICKS(MODBUS_TIMEOUT_MS)) == pdTRUE;
+}
+
+void ModbusRtuMaster::unlockBus() {
+  xSemaphoreGive(bus_);
+}
+
+ModbusResult ModbusRtuMaster::exchange(const ModbusFrame *request, ModbusFrame *response) {
+  // Arm the receiver before sending: the answer may start 3.5 characters
+  // after our last byte, sooner than the loop task is guaranteed to run
+  // again. Anything buffered up to here is noise or a stale answer.
+  xSemaphoreTake(rxLock_, portMAX_DELAY);
+  uart_flush_input(port_);
+  xSemaphoreTake(done_, 0);
+  response->length = 0;
+  rxResult_ = MODBUS_OK;
+  tx_ = request;
+  echoPending_ = true;
+  rx_ = response;
+  xSemaphoreGive(rxLock_);
+
+  uart_write_bytes(port_, (const char *)request->data, request->length);
+
+  if (xSemaphoreTake(done_, pdMS_TO_TICKS(MODBUS_TIMEOUT_MS)) != pdTRUE) {
+    xSemaphoreTake(rxLock_, portMAX_DELAY);
+    rx_ = nullptr;
+    xSemaphoreGive(rxLock_);
+    return MODBUS_TIMEOUT;
+  }
+  return rxResult_;
+}
+
+// ---- UART event task
+
+void ModbusRtuMaster::eventTask(void *arg) {
+  static_cast<ModbusRtuMaster *>(arg)->runEvents();
+}
+
+void ModbusRtuMaster::runEvents() {
+  uart_event_t event;
+  for (;;) {
+    if (xQueueReceive(events_, &event, portMAX_DELAY) != pdTRUE) continue;
+
+    switch (event.type) {
+      case UART_DATA:
+        onData(event.size, event.timeout_flag);
+        break;
+      case UART_FIFO_OVF:
+      case UART_BUFFER_FULL:
+        uart_flush_input(port_);
+        xQueueReset(events_);
+        completeFrame(MODBUS_BUS_ERROR);
+        break;
+      case UART_FRAME_ERR:
+      case UART_PARITY_ERR:
+        completeFrame(MODBUS_BUS_ERROR);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// Read straight into the pending response frame; the RX timeout flag marks
+// the end of the frame
+void ModbusRtuMaster::onData(size_t size, bool endOfFrame) {
+  xSemaphoreTake(rxLock_, portMAX_DELAY);
+  ModbusFrame *frame = rx_;
+  if (!frame) {
+    // Nobody waiting: drop the bytes
+    uart_flush_input(port_);
+    xSemaphoreGive(rxLock_);
+    return;
+  }
+
+  size_t room = sizeof(frame->data) - frame->length;
+  size_t take = size < room ? size : room;
+  int read = uart_read_bytes(port_, frame->data + frame->length, take, 0);
+  if (read > 0) frame->length += read;
+  // A transceiver without DE/RE control hears our request back before the
+  // answer: drop that copy, alone or run together with the answer. A write's
+  // answer is the request itself, so a lone copy of one only counts as the
+  // echo once reads have shown that this transceiver echoes.
+  size_t sent = tx_ ? tx_->length : 0;
+  if (endOfFrame && echoPending_ && sent && frame->length >= sent &&
+      memcmp(frame->data, tx_->data, sent) == 0 &&
+      (frame->length > sent || tx_->data[1] != 0x06 || echoes_)) {
+    echoPending_ = false;
+    echoes_ = true;
+    frame->length -= sent;
+    memmove(frame->data, frame->data + sent, frame->length);
+  }
+  xSemaphoreGive(rxLock_);
+
+  if (size > room) {
+    uart_flush_input(port_);
+    completeFrame(MODBUS_INVALID_RESPONSE);
+  } else if (endOfFrame && frame->length > 0) {
+    // (A timeout event left over from flushed noise carries no bytes)
+    completeFrame(MODBUS_OK);
+  }
+}
+
+void ModbusRtuMaster::completeFrame(ModbusResult result) {
+  xSemaphoreTake(rxLock_, portMAX_DELAY);
+  if (rx_) {
+    rx_ = nullptr;
+    rxResult_ = result;
+    xSemaphoreGive(done_);
+  }
+  xSemaphoreGive(rxLock_);
+}
+
+#endif // ESP8266
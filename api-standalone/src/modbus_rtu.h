@@ -0,0 +1,127 @@
+#ifndef MODBUS_RTU_H
+#define MODBUS_RTU_H
+
+#include <Arduino.h>
+#ifndef ESP8266
+#include <driver/uart.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
+#include "config.h"
+
+// ============================================
+// Event-driven Modbus RTU master
+// ============================================
+// Runs on the ESP-IDF UART driver instead of a polled task() loop:
+//  - end of frame is the UART's hardware RX timeout (MODBUS_RX_TIMEOUT_CHARS
+//    character times of silence), reported with the UART_DATA event, so a
+//    busy loop() can no longer stretch or split the inter-frame gap;
+//  - a small event task moves received bytes straight into the response
+//    frame and wakes the caller, so a transaction completes as soon as the
+//    last byte is in, with no polling step;
+//  - request and response frames come from a fixed pool and are built and
+//    parsed in place;
+//  - with MODBUS_FLOW_CONTROL_ENABLED, DE is the UART's RTS line in RS485
+//    half-duplex mode: the hardware releases it right after the last stop
+//    bit, and the receiver is armed before the request goes out, so a late
+//    loop task can no longer hold the driver on into the reply;
+//  - a transceiver without DE/RE control hears the request back first:
+//    that local echo is dropped and the master waits for the real answer.
+//
+// readHreg()/writeHreg() block the calling task until the slave answers or
+// MODBUS_TIMEOUT_MS passes. One transaction runs at a time; concurrent
+// callers wait for the bus.
+//
+// The ESP8266 core has no UART event API, so there the master drives a
+// HardwareSerial directly: it watches the gap after the last received byte
+// for the same MODBUS_RX_TIMEOUT_CHARS end of frame and yield()s while it
+// waits, and drives DE/RE itself around the write. Everything above the
+// transport (frames, CRC, checks, stats) is shared.
+
+enum ModbusResult {
+  MODBUS_OK,
+  MODBUS_TIMEOUT,
+  MODBUS_CRC_ERROR,
+  MODBUS_EXCEPTION,         // Slave answered with an exception code
+  MODBUS_INVALID_RESPONSE,  // Wrong slave, function, length or echo
+  MODBUS_BUS_ERROR,         // UART overrun, framing or parity error
+  MODBUS_BUSY,              // Bus or frame pool not available
+  MODBUS_RESULT_COUNT
+};
+
+struct ModbusFrame {
+  uint8_t data[MODBUS_FRAME_SIZE];
+  uint16_t length;
+  bool busy;
+};
+
+struct ModbusBusStats {
+  uint32_t transactions;
+  uint32_t results[MODBUS_RESULT_COUNT];
+  uint32_t lastLatencyUs;   // Request start to last response byte
+  uint32_t maxLatencyUs;
+  uint8_t lastException;
+};
+
+class ModbusRtuMaster {
+ public:
+#ifdef ESP8266
+  bool begin(HardwareSerial &serial, uint32_t baud);
+#else
+  bool begin(uart_port_t port, int txPin, int rxPin, uint32_t baud);
+#endif
+
+  // Function 0x03: count registers starting at address
+  ModbusResult readHreg(uint8_t slave, uint16_t address, uint16_t *values, uint16_t count);
+  // Function 0x06: single register
+  ModbusResult writeHreg(uint8_t slave, uint16_t address, uint16_t value);
+
+  const ModbusBusStats &stats() const { return stats_; }
+  static const char *resultName(ModbusResult result);
+  static uint16_t crc16(const uint8_t *data, size_t length);
+
+ private:
+  ModbusFrame *acquireFrame();
+  void releaseFrame(ModbusFrame *frame);
+  ModbusResult transact(ModbusFrame *request, ModbusFrame *response);
+  ModbusResult finish(ModbusResult result, uint32_t startUs);
+
+  // Transport: one transaction at a time, raw frame out, raw frame back
+  bool lockBus();
+  void unlockBus();
+  ModbusResult exchange(const ModbusFrame *request, ModbusFrame *response);
+
+#ifdef ESP8266
+  void setTransmit(bool transmit);
+
+  HardwareSerial *serial_ = nullptr;
+  uint32_t charUs_ = 0;                   // One character at the bus baud rate
+  uint32_t frameGapUs_ = 0;               // End-of-frame silence at the bus baud rate
+#else
+  static void eventTask(void *arg);
+  void runEvents();
+  void onData(size_t size, bool endOfFrame);
+  void completeFrame(ModbusResult result);
+
+  uart_port_t port_ = UART_NUM_MAX;
+  QueueHandle_t events_ = nullptr;
+  SemaphoreHandle_t bus_ = nullptr;       // One transaction at a time
+  SemaphoreHandle_t rxLock_ = nullptr;    // Guards rx_ between caller and event task
+  SemaphoreHandle_t done_ = nullptr;      // Given by the event task per response
+  StaticSemaphore_t busBuffer_;
+  StaticSemaphore_t rxLockBuffer_;
+  StaticSemaphore_t doneBuffer_;
+  ModbusFrame *rx_ = nullptr;             // Response being received, if any
+  const ModbusFrame *tx_ = nullptr;       // Its request, to recognise an echo
+  bool echoPending_ = false;              // No echo dropped yet this exchange
+  bool echoes_ = false;                   // The transceiver was heard echoing
+  ModbusResult rxResult_ = MODBUS_OK;
+#endif
+
+  ModbusFrame frames_[MODBUS_FRAME_POOL];
+  ModbusBusStats stats_ = {};
+};
+
+#endif // MODBUS_RTU_H
@@ -0,0 +1,146 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "config.h"
+
+// ============================================
+// Loop / task latency profiler
+// ============================================
+// PROFILE_SCOPE(histogram) times the enclosing block with the CPU cycle
+// counter and records it into a histogram. The counter is per core: a scope
+// that ends on another core than it started on (async_tcp is not pinned)
+// is timed with micros() instead. Each histogram is written by a
+// single task only (loop stages and Modbus transactions from the loop task,
+// HTTP handlers from async_tcp), so recording needs no locks; a reader on
+// another task may at worst see a sample half-applied.
+//
+// With PROFILER_ENABLED=0 the macro expands to nothing and none of the
+// types below exist.
+
+#if PROFILER_ENABLED
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Bucket b counts samples in [2^(b-1), 2^b) us; the last one is open-ended
+#define PROFILER_BUCKETS 25
+
+struct ProfileSample {
+  uint32_t us;
+  uint32_t atMs;
+};
+
+struct ProfileHistogram {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+  uint32_t lastUs;
+  uint32_t buckets[PROFILER_BUCKETS];
+  ProfileSample slowest[PROFILER_SLOWEST_SAMPLES];
+
+  void record(uint32_t us, uint32_t nowMs) {
+    count++;
+    totalUs += us;
+    lastUs = us;
+    if (us > maxUs) maxUs = us;
+
+    uint8_t bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    if (bucket >= PROFILER_BUCKETS) bucket = PROFILER_BUCKETS - 1;
+    buckets[bucket]++;
+
+    // Replace the fastest of the kept slow samples
+    uint8_t fastest = 0;
+    for (uint8_t i = 1; i < PROFILER_SLOWEST_SAMPLES; i++) {
+      if (slowest[i].us < slowest[fastest].us) fastest = i;
+    }
+    if (us > slowest[fastest].us) {
+      slowest[fastest].us = us;
+      slowest[fastest].atMs = nowMs;
+    }
+  }
+
+  void toJson(JsonObject out) const {
+    out["count"] = count;
+    out["mean_us"] = count ? (uint32_t)(totalUs / count) : 0;
+    out["max_us"] = maxUs;
+    out["last_us"] = lastUs;
+
+    // Sparse histogram: [upper bound in us (0 = open), samples]
+    JsonArray histogram = out["histogram"].to<JsonArray>();
+    for (uint8_t b = 0; b < PROFILER_BUCKETS; b++) {
+      if (!buckets[b]) continue;
+      JsonArray bin = histogram.add<JsonArray>();
+      bin.add(b == PROFILER_BUCKETS - 1 ? 0 : (uint32_t)1 << b);
+      bin.add(buckets[b]);
+    }
+
+    // Slowest samples, worst first: [us, millis() when recorded]
+    ProfileSample sorted[PROFILER_SLOWEST_SAMPLES];
+    memcpy(sorted, slowest, sizeof(sorted));
+    for (uint8_t i = 1; i < PROFILER_SLOWEST_SAMPLES; i++) {
+      ProfileSample sample = sorted[i];
+      int8_t j = i - 1;
+      while (j >= 0 && sorted[j].us < sample.us) {
+        sorted[j + 1] = sorted[j];
+        j--;
+      }
+      sorted[j + 1] = sample;
+    }
+    JsonArray slow = out["slowest"].to<JsonArray>();
+    for (uint8_t i = 0; i < PROFILER_SLOWEST_SAMPLES && sorted[i].us; i++) {
+      JsonArray sample = slow.add<JsonArray>();
+      sample.add(sorted[i].us);
+      sample.add(sorted[i].atMs);
+    }
+  }
+};
+
+inline uint32_t profilerCpuMHz() {
+  static uint32_t mhz = ESP.getCpuFreqMHz();
+  return mhz;
+}
+
+inline uint8_t profilerCoreId() {
+#if defined(ESP8266) || CONFIG_FREERTOS_UNICORE
+  return 0;
+#else
+  return xPortGetCoreID();
+#endif
+}
+
+class ProfileScope {
+ public:
+  explicit ProfileScope(ProfileHistogram &histogram)
+      : histogram_(histogram), startCore_(profilerCoreId()), startCycles_(ESP.getCycleCount()),
+        startMicros_(micros()) {}
+
+  ~ProfileScope() {
+    uint32_t cycles = ESP.getCycleCount() - startCycles_;
+    uint32_t us = micros() - startMicros_;
+    // The cycle counter wraps every 2^32 cycles (~18 s at 240 MHz); past
+    // half of that the microsecond clock is the safer measurement. Cycle
+    // counts from two different cores cannot be subtracted at all.
+    if (profilerCoreId() == startCore_ && us < 0x7FFFFFFFu / profilerCpuMHz()) {
+      us = cycles / profilerCpuMHz();
+    }
+    histogram_.record(us, millis());
+  }
+
+ private:
+  ProfileHistogram &histogram_;
+  uint8_t startCore_;
+  uint32_t startCycles_;
+  uint32_t startMicros_;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(histogram) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(histogram)
+
+#else
+
+#define PROFILE_SCOPE(histogram)
+
+#endif // PROFILER_ENABLED
+
+#endif // PROFILER_H
@@ -0,0 +1,181 @@
+#ifndef ROLLING_STATS_H
+#define ROLLING_STATS_H
+
+#include <math.h>
+#include <stdint.h>
+
+// ============================================
+// Sliding-window statistics in fixed memory
+// ============================================
+// A window is split into Slots time slots of slotMs each; it covers the
+// current (partial) slot plus the Slots-1 before it. Every sample costs O(1):
+//  - mean/variance: Welford update of the running window total and of the
+//    current slot; an expiring slot is subtracted back out of the total
+//    (inverse of Chan's parallel merge), so history is never re-scanned.
+//  - min/max: monotonic deques of (slot, value). A sample only needs to be
+//    kept if it beats every newer one, and at most one entry per slot is
+//    kept, so each deque holds at most Slots entries.
+// Slots only expire as time moves on, so readers take a snapshot(now): a
+// window that stopped getting samples empties instead of reporting old data.
+
+template <uint8_t Slots>
+class RollingWindow {
+ public:
+  void begin(uint32_t slotMs) {
+    slotMs_ = slotMs;
+    reset(0);
+  }
+
+  void add(float value, uint32_t nowMs) {
+    advance(nowMs / slotMs_);
+
+    Aggregate &slot = slots_[headSlot_ % Slots];
+    welfordAdd(slot.count, slot.mean, slot.m2, value);
+
+    uint32_t n = count_;
+    welfordAdd(n, mean_, m2_, value);
+    count_ = n;
+
+    maxDeque_.push(headSlot_, value, true);
+    minDeque_.push(headSlot_, value, false);
+  }
+
+  struct Snapshot {
+    uint32_t count;
+    double mean;
+    double stddev;
+    float min;
+    float max;
+  };
+
+  // The window as of nowMs, on a copy: the writer's state is not touched
+  Snapshot snapshot(uint32_t nowMs) const {
+    RollingWindow window = *this;
+    window.advance(nowMs / slotMs_);
+    Snapshot result = {window.count(), window.mean(), window.stddev(), window.min(), window.max()};
+    return result;
+  }
+
+  uint32_t count() const { return count_; }
+  double mean() const { return mean_; }
+  double stddev() const { return count_ > 1 ? sqrt(m2_ / (count_ - 1)) : 0.0; }
+  float min() const { return minDeque_.front(); }
+  float max() const { return maxDeque_.front(); }
+  uint32_t spanMs() const { return slotMs_ * Slots; }
+
+ private:
+  struct Aggregate {
+    uint32_t count;
+    float mean;
+    float m2;
+  };
+
+  class MonotonicDeque {
+   public:
+    void clear() { head_ = size_ = 0; }
+
+    // keepLarger = true for the max deque
+    void push(uint32_t slot, float value, bool keepLarger) {
+      while (size_ > 0) {
+        Entry &back = at(size_ - 1);
+        bool dominated = keepLarger ? back.value <= value : back.value >= value;
+        if (!dominated) break;
+        size_--;
+      }
+      // An older-or-equal value in the same slot expires with this one
+      if (size_ > 0 && at(size_ - 1).slot == slot) return;
+      Entry &entry = at(size_++);
+      entry.slot = slot;
+      entry.value = value;
+    }
+
+    void expireBefore(uint32_t oldestSlot) {
+      while (size_ > 0 && at(0).slot < oldestSlot) {
+        head_ = (head_ + 1) % Slots;
+        size_--;
+      }
+    }
+
+    float front() const { return size_ > 0 ? entries_[head_].value : NAN; }
+
+   private:
+    struct Entry {
+      uint32_t slot;
+      float value;
+    };
+
+    Entry &at(uint8_t i) { return entries_[(head_ + i) % Slots]; }
+
+    Entry entries_[Slots];
+    uint8_t head_ = 0;
+    uint8_t size_ = 0;
+  };
+
+  template <typename Count, typename Real>
+  static void welfordAdd(Count &count, Real &mean, Real &m2, float value) {
+    count++;
+    Real delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+  }
+
+  void reset(uint32_t slot) {
+    for (uint8_t i = 0; i < Slots; i++) slots_[i] = Aggregate();
+    count_ = 0;
+    mean_ = 0.0;
+    m2_ = 0.0;
+    headSlot_ = slot;
+    maxDeque_.clear();
+    minDeque_.clear();
+  }
+
+  // Move the head to `slot`, dropping every slot that falls out of the window
+  void advance(uint32_t slot) {
+    if (slot == headSlot_) return;
+    if (slot < headSlot_ || slot - headSlot_ >= Slots) {
+      // millis() wrapped, or the whole window is stale
+      reset(slot);
+      return;
+    }
+
+    while (headSlot_ != slot) {
+      headSlot_++;
+      Aggregate &expired = slots_[headSlot_ % Slots];
+      removeFromTotal(expired);
+      expired = Aggregate();
+    }
+
+    uint32_t oldest = slot >= Slots - 1 ? slot - (Slots - 1) : 0;
+    maxDeque_.expireBefore(oldest);
+    minDeque_.expireBefore(oldest);
+  }
+
+  void removeFromTotal(const Aggregate &slot) {
+    if (slot.count == 0) return;
+    if (slot.count >= count_) {
+      count_ = 0;
+      mean_ = 0.0;
+      m2_ = 0.0;
+      return;
+    }
+
+    uint32_t remaining = count_ - slot.count;
+    double remainingMean = (count_ * mean_ - slot.count * (double)slot.mean) / remaining;
+    double delta = slot.mean - remainingMean;
+    m2_ -= slot.m2 + delta * delta * remaining * slot.count / count_;
+    if (m2_ < 0.0) m2_ = 0.0;  // Rounding can leave a tiny negative residue
+    mean_ = remainingMean;
+    count_ = remaining;
+  }
+
+  Aggregate slots_[Slots];
+  MonotonicDeque maxDeque_;
+  MonotonicDeque minDeque_;
+  uint32_t slotMs_ = 1000;
+  uint32_t headSlot_ = 0;
+  uint32_t count_ = 0;
+  double mean_ = 0.0;
+  double m2_ = 0.0;
+};
+
+#endif // ROLLING_STATS_H
@@ -0,0 +1,99 @@
+#include "settings_store.h"
+
+#ifdef ESP8266
+
+#include <LittleFS.h>
+
+// File layout: the raw entry table. A file of any other size (written by a
+// build with different SETTINGS_* limits) reads as an empty namespace.
+
+bool SettingsStore::begin(const char *name, bool readOnly) {
+  if (open_) end();
+  snprintf(path_, sizeof(path_), "/settings/%s", name);
+  memset(entries_, 0, sizeof(entries_));
+  readOnly_ = readOnly;
+  dirty_ = false;
+  open_ = true;
+
+  File file = LittleFS.open(path_, "r");
+  if (file) {
+    if (file.size() != sizeof(entries_) ||
+        file.read((uint8_t *)entries_, sizeof(entries_)) != sizeof(entries_)) {
+      memset(entries_, 0, sizeof(entries_));
+    }
+    file.close();
+  }
+  return true;
+}
+
+void SettingsStore::end() {
+  if (open_ && dirty_ && !readOnly_) {
+    File file = LittleFS.open(path_, "w");
+    if (file) {
+      file.write((const uint8_t *)entries_, sizeof(entries_));
+      file.close();
+    }
+  }
+  open_ = false;
+  dirty_ = false;
+}
+
+SettingsStore::Entry *SettingsStore::find(const char *key) {
+  for (uint8_t i = 0; i < SETTINGS_MAX_KEYS; i++) {
+    if (entries_[i].key[0] && strncmp(entries_[i].key, key, sizeof(entries_[i].key)) == 0) {
+      return &entries_[i];
+    }
+  }
+  return nullptr;
+}
+
+size_t SettingsStore::put(const char *key, const char *value) {
+  size_t length = strlen(value);
+  if (!open_ || readOnly_ || strlen(key) >= SETTINGS_KEY_LEN || length >= SETTINGS_VALUE_LEN) return 0;
+
+  Entry *entry = find(key);
+  for (uint8_t i = 0; !entry && i < SETTINGS_MAX_KEYS; i++) {
+    if (!entries_[i].key[0]) {
+      entry = &entries_[i];
+      strlcpy(entry->key, key, sizeof(entry->key));
+    }
+  }
+  if (!entry) return 0;
+
+  if (strcmp(entry->value, value) != 0) {
+    strlcpy(entry->value, value, sizeof(entry->value));
+    dirty_ = true;
+  }
+  return length;
+}
+
+size_t SettingsStore::getString(const char *key, char *value, size_t maxLen) {
+  const Entry *entry = open_ ? find(key) : nullptr;
+  if (!entry || maxLen == 0) return 0;
+  strlcpy(value, entry->value, maxLen);
+  return strlen(value);
+}
+
+size_t SettingsStore::putString(const char *key, const char *value) {
+  return put(key, value);
+}
+
+uint32_t SettingsStore::getUInt(const char *key, uint32_t defaultValue) {
+  const Entry *entry = open_ ? find(key) : nullptr;
+  return entry ? strtoul(entry->value, NULL, 10) : defaultValue;
+}
+
+size_t SettingsStore::putUInt(const char *key, uint32_t value) {
+  char text[11];
+  snprintf(text, sizeof(text), "%lu", (unsigned long)value);
+  return put(key, text) ? sizeof(value) : 0;
+}
+
+bool SettingsStore::clear() {
+  if (!open_ || readOnly_) return false;
+  memset(entries_, 0, sizeof(entries_));
+  dirty_ = true;
+  return true;
+}
+
+#endif // ESP8266
@@ -0,0 +1,52 @@
+#ifndef SETTINGS_STORE_H
+#define SETTINGS_STORE_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// ============================================
+// Persistent settings
+// ============================================
+// ESP32: NVS through Preferences. ESP8266: one LittleFS file per namespace,
+// behind the subset of the Preferences API the firmware uses. The namespace
+// opened by begin() is held in a fixed table until end(), which writes the
+// file back only if something changed. LittleFS must be mounted first.
+
+#ifndef ESP8266
+
+#include <Preferences.h>
+typedef Preferences SettingsStore;
+
+#else
+
+class SettingsStore {
+ public:
+  bool begin(const char *name, bool readOnly = false);
+  void end();
+
+  // Like Preferences: a missing key leaves value untouched and returns 0
+  size_t getString(const char *key, char *value, size_t maxLen);
+  size_t putString(const char *key, const char *value);
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+  size_t putUInt(const char *key, uint32_t value);
+  bool clear();
+
+ private:
+  struct Entry {
+    char key[SETTINGS_KEY_LEN];
+    char value[SETTINGS_VALUE_LEN];
+  };
+
+  Entry *find(const char *key);
+  size_t put(const char *key, const char *value);
+
+  char path_[32];
+  Entry entries_[SETTINGS_MAX_KEYS];
+  bool open_ = false;
+  bool readOnly_ = true;
+  bool dirty_ = false;
+};
+
+#endif // ESP8266
+
+#endif // SETTINGS_STORE_H
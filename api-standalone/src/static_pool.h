@@ -0,0 +1,149 @@
+#ifndef STATIC_POOL_H
+#define STATIC_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <ArduinoJson.h>
+
+// ============================================
+// Static memory for the HTTP request path
+// ============================================
+// Every buffer here is sized at compile time (see config.h) so serving a
+// request never touches the heap for the JSON document or the serialized
+// payload. AsyncWebServer handlers and disconnect callbacks all run on the
+// async_tcp task, so these pools are only ever touched from one task and
+// need no locking.
+
+// Bump allocator backing request-scoped JsonDocuments.
+// reset() at the start of each handler reclaims the whole arena at once.
+template <size_t N>
+class JsonArena : public ArduinoJson::Allocator {
+ public:
+  void reset() {
+    used_ = 0;
+    last_ = nullptr;
+  }
+
+  size_t capacity() const { return N; }
+  size_t used() const { return used_; }
+  size_t peak() const { return peak_; }
+  uint32_t failures() const { return failures_; }
+
+  void* allocate(size_t size) override {
+    size_t total = align(sizeof(Header) + size);
+    if (used_ + total > N) {
+      failures_++;
+      return nullptr;
+    }
+    Header* header = reinterpret_cast<Header*>(buffer_ + used_);
+    header->size = size;
+    last_ = header;
+    used_ += total;
+    if (used_ > peak_) peak_ = used_;
+    return header + 1;
+  }
+
+  // Only the most recent block can be given back; anything else is
+  // reclaimed by the next reset().
+  void deallocate(void* ptr) override {
+    if (ptr && headerOf(ptr) == last_) {
+      used_ = reinterpret_cast<uint8_t*>(last_) - buffer_;
+      last_ = nullptr;
+    }
+  }
+
+  void* reallocate(void* ptr, size_t newSize) override {
+    if (!ptr) return allocate(newSize);
+
+    Header* header = headerOf(ptr);
+    if (header == last_) {
+      // Grow or shrink the tail block in place
+      size_t start = reinterpret_cast<uint8_t*>(header) - buffer_;
+      size_t total = align(sizeof(Header) + newSize);
+      if (start + total > N) {
+        failures_++;
+        return nullptr;
+      }
+      header->size = newSize;
+      used_ = start + total;
+      if (used_ > peak_) peak_ = used_;
+      return ptr;
+    }
+
+    if (newSize <= header->size) return ptr;
+
+    void* moved = allocate(newSize);
+    if (moved) memcpy(moved, ptr, header->size);
+    return moved;
+  }
+
+ private:
+  struct alignas(8) Header {
+    size_t size;
+  };
+
+  static size_t align(size_t size) { return (size + 7) & ~size_t(7); }
+  static Header* headerOf(void* ptr) { return static_cast<Header*>(ptr) - 1; }
+
+  alignas(8) uint8_t buffer_[N];
+  size_t used_ = 0;
+  size_t peak_ = 0;
+  uint32_t failures_ = 0;
+  Header* last_ = nullptr;
+};
+
+// Fixed set of response buffers. A slot is held from the moment a handler
+// serializes into it until the client disconnects, because AsyncWebServer
+// streams the payload out over several TCP acks after the handler returns.
+template <size_t SlotSize, size_t SlotCount>
+class ResponsePool {
+ public:
+  struct Slot {
+    char data[SlotSize];
+    bool busy;
+  };
+
+  Slot* acquire() {
+    for (size_t i = 0; i < SlotCount; i++) {
+      if (!slots_[i].busy) {
+        slots_[i].busy = true;
+        inUse_++;
+        if (inUse_ > peakInUse_) peakInUse_ = inUse_;
+        return &slots_[i];
+      }
+    }
+    exhausted_++;
+    return nullptr;
+  }
+
+  void release(Slot* slot) {
+    if (slot && slot->busy) {
+      slot->busy = false;
+      inUse_--;
+    }
+  }
+
+  static constexpr size_t slotSize() { return SlotSize; }
+  static constexpr size_t slotCount() { return SlotCount; }
+  size_t inUse() const { return inUse_; }
+  size_t peakInUse() const { return peakInUse_; }
+  uint32_t exhausted() const { return exhausted_; }
+
+ private:
+  Slot slots_[SlotCount] = {};
+  size_t inUse_ = 0;
+  size_t peakInUse_ = 0;
+  uint32_t exhausted_ = 0;
+};
+
+// Per-route counters reported under "routes" in /api/status
+struct RouteStats {
+  const char* path;
+  uint32_t requests;
+  uint32_t arenaPeak;     // Largest JSON arena footprint for this route
+  uint32_t responsePeak;  // Largest serialized payload for this route
+  uint32_t failures;      // Arena overflow, oversized payload or no free slot
+};
+
+#endif // STATIC_POOL_H